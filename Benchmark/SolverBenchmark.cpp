@@ -0,0 +1,341 @@
+// SolverBenchmark.cpp
+// Runs the particle solver without a window and prints the results as JSON.
+//
+//   SolverBenchmark [--particles N] [--radius-min R] [--radius-max R] [--box W H]
+//                   [--map lvl1.txt] [--steps N] [--warmup N] [--threads N]
+//                   [--substeps N] [--seed N] [--simd scalar|sse|avx2] [--no-sleep]
+//                   [--reorder-interval N] [--reorder-threshold F] [--focus W H]
+//                   [--active W H] [--verify]
+//
+// --verify runs the scalar, SSE and AVX2 integrate kernels from the warmed up state instead of timing
+// and fails when one strays from the scalar result by more than verifyTolerance.
+
+#include "Solver.hpp"
+#include "ParticleKernels.hpp"
+#include "Level.hpp"
+#include "Enemy.hpp"
+#include "GameData.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+    struct Options {
+        int particles = 2500;
+        float radiusMin = 7.f;
+        float radiusMax = 7.f;
+        sf::Vector2f box{ 800.f, 800.f };
+        std::string map;
+        int steps = 600;
+        int warmup = 60;
+        int threads = static_cast<int>(std::thread::hardware_concurrency());
+        int substeps = 3;
+        unsigned int seed = 1;
+        ParticleKernels::InstructionSet simd = ParticleKernels::detectInstructionSet();
+        bool sleeping = true;
+        int reorderInterval = -1;       // -1 keeps the solver default
+        float reorderThreshold = -1.f;
+        sf::Vector2f focus;             // full rate area in the top left corner, none when empty
+        sf::Vector2f active;            // simulated area in the top left corner, the rest is paged out
+        bool verify = false;
+    };
+
+    void printUsage() {
+        std::fprintf(stderr,
+            "usage: SolverBenchmark [--particles N] [--radius-min R] [--radius-max R] [--box W H]\n"
+            "                       [--map lvl1.txt] [--steps N] [--warmup N] [--threads N]\n"
+            "                       [--substeps N] [--seed N] [--simd scalar|sse|avx2] [--no-sleep]\n"
+            "                       [--reorder-interval N] [--reorder-threshold F] [--focus W H]\n"
+            "                       [--active W H] [--verify]\n");
+    }
+
+    bool parseInstructionSet(const std::string& name, ParticleKernels::InstructionSet& set) {
+        if (name == "scalar") set = ParticleKernels::InstructionSet::Scalar;
+        else if (name == "sse") set = ParticleKernels::InstructionSet::SSE;
+        else if (name == "avx2") set = ParticleKernels::InstructionSet::AVX2;
+        else return false;
+        return true;
+    }
+
+    bool parseOptions(int argc, char** argv, Options& options) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+
+            if (arg == "--particles" && hasValue) options.particles = std::atoi(argv[++i]);
+            else if (arg == "--radius-min" && hasValue) options.radiusMin = static_cast<float>(std::atof(argv[++i]));
+            else if (arg == "--radius-max" && hasValue) options.radiusMax = static_cast<float>(std::atof(argv[++i]));
+            else if (arg == "--box" && i + 2 < argc) {
+                options.box.x = static_cast<float>(std::atof(argv[++i]));
+                options.box.y = static_cast<float>(std::atof(argv[++i]));
+            }
+            else if (arg == "--map" && hasValue) options.map = argv[++i];
+            else if (arg == "--steps" && hasValue) options.steps = std::atoi(argv[++i]);
+            else if (arg == "--warmup" && hasValue) options.warmup = std::atoi(argv[++i]);
+            else if (arg == "--threads" && hasValue) options.threads = std::atoi(argv[++i]);
+            else if (arg == "--substeps" && hasValue) options.substeps = std::atoi(argv[++i]);
+            else if (arg == "--seed" && hasValue) options.seed = static_cast<unsigned int>(std::atoi(argv[++i]));
+            else if (arg == "--simd" && hasValue) {
+                if (!parseInstructionSet(argv[++i], options.simd)) {
+                    std::fprintf(stderr, "unknown instruction set: %s\n", argv[i]);
+                    return false;
+                }
+            }
+            else if (arg == "--no-sleep") options.sleeping = false;
+            else if (arg == "--verify") options.verify = true;
+            else if (arg == "--reorder-interval" && hasValue) options.reorderInterval = std::atoi(argv[++i]);
+            else if (arg == "--reorder-threshold" && hasValue) options.reorderThreshold = static_cast<float>(std::atof(argv[++i]));
+            else if (arg == "--focus" && i + 2 < argc) {
+                options.focus.x = static_cast<float>(std::atof(argv[++i]));
+                options.focus.y = static_cast<float>(std::atof(argv[++i]));
+            }
+            else if (arg == "--active" && i + 2 < argc) {
+                options.active.x = static_cast<float>(std::atof(argv[++i]));
+                options.active.y = static_cast<float>(std::atof(argv[++i]));
+            }
+            else {
+                std::fprintf(stderr, "unknown or incomplete option: %s\n", arg.c_str());
+                return false;
+            }
+        }
+
+        if (options.radiusMax < options.radiusMin)
+            options.radiusMax = options.radiusMin;
+        if (options.threads < 1)
+            options.threads = 1;
+        return options.particles >= 0 && options.steps > 0 && options.radiusMin > 0.f;
+    }
+
+    // particles on a lattice from the top of the box down, radii uniform between min and max
+    bool buildBoxScene(const Options& options, Solver& solver, sf::RectangleShape& bounds) {
+        bounds.setSize(options.box);
+        bounds.setOrigin(options.box / 2.f);
+        bounds.setPosition(options.box / 2.f);
+
+        float spacing = options.radiusMax * 2.f + 1.f;
+        int perRow = static_cast<int>((options.box.x - spacing) / spacing);
+        int rowsFit = static_cast<int>((options.box.y - spacing) / spacing);
+        if (perRow < 1 || static_cast<long long>(perRow) * rowsFit < options.particles) {
+            std::fprintf(stderr, "%d particles of radius %.1f do not fit in a %.0f x %.0f box\n",
+                options.particles, options.radiusMax, options.box.x, options.box.y);
+            return false;
+        }
+
+        for (int i = 0; i < options.particles; ++i) {
+            float t = static_cast<float>(std::rand()) / RAND_MAX;
+            float radius = options.radiusMin + (options.radiusMax - options.radiusMin) * t;
+            float jitter = static_cast<float>(std::rand() % 4);
+
+            sf::Vector2f pos(spacing + (i % perRow) * spacing + jitter, spacing + (i / perRow) * spacing);
+            solver.addObject(pos, radius);
+        }
+        return true;
+    }
+
+    long long peakMemoryKb() {
+#if defined(_WIN32)
+        PROCESS_MEMORY_COUNTERS counters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return static_cast<long long>(counters.PeakWorkingSetSize / 1024);
+        return 0;
+#else
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+        return usage.ru_maxrss / 1024;  // bytes on macOS
+#else
+        return usage.ru_maxrss;         // kilobytes on Linux
+#endif
+#endif
+    }
+
+    // map paths on Windows are full of backslashes, they and quotes would break the JSON string
+    std::string jsonEscape(const std::string& text) {
+        std::string escaped;
+        for (char c : text) {
+            if (c == '\\' || c == '"') {
+                escaped += '\\';
+                escaped += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20) {
+                char code[8];
+                std::snprintf(code, sizeof(code), "\\u%04x", c);
+                escaped += code;
+            }
+            else {
+                escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    // pixels, the vector kernels do the same float operations in the same order as the scalar one
+    // so anything above rounding noise is a bug
+    const float verifyTolerance = 1e-3f;
+    const int verifyIterations = 60;
+
+    // Runs integrate on copies of the solver state with every instruction set the cpu has and compares
+    // the positions with the scalar run. The sleeping flags are copied too so mixed blocks are covered.
+    int verifyKernels(const Solver& solver, const sf::RectangleShape& bounds) {
+        const int count = solver.getObjectCount();
+        std::vector<sf::Vector2f> startPositions = solver.getPositions();
+        std::vector<sf::Vector2f> startLast(count);
+        std::vector<unsigned char> sleeping(count);
+        for (int i = 0; i < count; ++i) {
+            startLast[i] = startPositions[i] - solver.getVelocity(i);
+            sleeping[i] = solver.isSleeping(i) ? 1 : 0;
+        }
+
+        sf::Vector2f topLeft = bounds.getPosition() - bounds.getOrigin();
+        ParticleKernels::Bounds box{ topLeft.x, topLeft.y, topLeft.x + bounds.getSize().x, topLeft.y + bounds.getSize().y };
+        float dt = solver.getFixedTimestep() / solver.getSubsteps();
+
+        auto run = [&](ParticleKernels::InstructionSet set, std::vector<sf::Vector2f>& positions) {
+            ParticleKernels::setInstructionSet(set);
+            positions = startPositions;
+            std::vector<sf::Vector2f> last = startLast;
+            std::vector<sf::Vector2f> accelerations(count);
+            for (int k = 0; k < verifyIterations; ++k) {
+                std::fill(accelerations.begin(), accelerations.end(), sf::Vector2f(0.f, 600.f));
+                ParticleKernels::integrate(positions.data(), last.data(), accelerations.data(), solver.getRadii().data(),
+                    sleeping.data(), count, box, dt, 0.99f, 0.95f);
+            }
+        };
+
+        const ParticleKernels::InstructionSet best = ParticleKernels::detectInstructionSet();
+        std::vector<sf::Vector2f> scalar;
+        run(ParticleKernels::InstructionSet::Scalar, scalar);
+
+        bool passed = true;
+        std::printf("{\n");
+        std::printf("  \"particles\": %d,\n", count);
+        std::printf("  \"iterations\": %d,\n", verifyIterations);
+        std::printf("  \"tolerance\": %g,\n", verifyTolerance);
+        std::printf("  \"kernels\": [");
+        const ParticleKernels::InstructionSet sets[] = { ParticleKernels::InstructionSet::SSE, ParticleKernels::InstructionSet::AVX2 };
+        bool first = true;
+        for (ParticleKernels::InstructionSet set : sets) {
+            if (static_cast<int>(set) > static_cast<int>(best)) continue;
+
+            std::vector<sf::Vector2f> positions;
+            run(set, positions);
+            float maxError = 0.f;
+            for (int i = 0; i < count; ++i) {
+                maxError = std::max({ maxError, std::abs(positions[i].x - scalar[i].x), std::abs(positions[i].y - scalar[i].y) });
+            }
+            bool ok = maxError <= verifyTolerance;
+            passed = passed && ok;
+            std::printf("%s\n    { \"instruction_set\": \"%s\", \"max_error\": %g, \"passed\": %s }", first ? "" : ",",
+                ParticleKernels::getInstructionSetName(set), maxError, ok ? "true" : "false");
+            first = false;
+        }
+        std::printf("\n  ],\n");
+        std::printf("  \"passed\": %s\n", passed ? "true" : "false");
+        std::printf("}\n");
+
+        ParticleKernels::setInstructionSet(best);
+        return passed ? 0 : 1;
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    std::srand(options.seed);
+    ParticleKernels::setInstructionSet(options.simd);
+
+    // the game state is only needed for map scenes, it holds the solver either way
+    auto gameData = std::make_unique<GameData>();
+    Level level;
+    Enemy enemy({ 0.f, 0.f }, 0);
+    Solver& solver = gameData->particleSolver;
+    sf::RectangleShape boxBounds;
+    const sf::RectangleShape* bounds = &boxBounds;
+
+    if (!options.map.empty()) {
+        level.customMapFile = true;
+        level.customMapFileName = options.map;
+        level.spawnSeed = options.seed;
+        level.prefetchEnabled = false;
+        level.load(*gameData, enemy);
+        if (level.map.empty()) return 1;
+        bounds = &level.bounds;
+    }
+    else if (!buildBoxScene(options, solver, boxBounds)) {
+        return 1;
+    }
+
+    solver.setThreadCount(options.threads);
+    solver.setSubsteps(options.substeps);
+    solver.setSleepingEnabled(options.sleeping);
+    if (options.reorderInterval >= 0)
+        solver.setReorderInterval(options.reorderInterval);
+    if (options.reorderThreshold >= 0.f)
+        solver.setReorderThreshold(options.reorderThreshold);
+    if (options.focus.x > 0.f && options.focus.y > 0.f)
+        solver.setFocusArea(sf::FloatRect(bounds->getPosition() - bounds->getOrigin(), options.focus));
+    if (options.active.x > 0.f && options.active.y > 0.f)
+        solver.setActiveArea(sf::FloatRect(bounds->getPosition() - bounds->getOrigin(), options.active));
+
+    for (int i = 0; i < options.warmup; ++i)
+        solver.step(*bounds);
+    solver.resetStats();
+
+    if (options.verify)
+        return verifyKernels(solver, *bounds);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.steps; ++i)
+        solver.step(*bounds);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const Solver::Stats& stats = solver.getStats();
+    // paged out particles are part of the scene even though the solver does not step them
+    int count = solver.getObjectCount() + solver.getPagedOutCount();
+    double particleSteps = static_cast<double>(count) * options.steps;
+
+    std::printf("{\n");
+    std::printf("  \"scene\": \"%s\",\n", options.map.empty() ? "box" : jsonEscape(options.map).c_str());
+    std::printf("  \"particles\": %d,\n", count);
+    std::printf("  \"bounds\": [%.1f, %.1f],\n", bounds->getSize().x, bounds->getSize().y);
+    std::printf("  \"radius\": [%.2f, %.2f],\n", options.radiusMin, options.radiusMax);
+    std::printf("  \"steps\": %d,\n", options.steps);
+    std::printf("  \"warmup_steps\": %d,\n", options.warmup);
+    std::printf("  \"substeps\": %d,\n", solver.getSubsteps());
+    std::printf("  \"threads\": %d,\n", solver.getThreadCount());
+    std::printf("  \"instruction_set\": \"%s\",\n",
+        ParticleKernels::getInstructionSetName(ParticleKernels::getInstructionSet()));
+    std::printf("  \"sleeping\": %s,\n", options.sleeping ? "true" : "false");
+    std::printf("  \"focus\": [%.1f, %.1f],\n", options.focus.x, options.focus.y);
+    std::printf("  \"active\": [%.1f, %.1f],\n", options.active.x, options.active.y);
+    std::printf("  \"seconds\": %.6f,\n", seconds);
+    std::printf("  \"steps_per_second\": %.2f,\n", options.steps / seconds);
+    std::printf("  \"ns_per_particle_step\": %.2f,\n", particleSteps > 0 ? seconds * 1e9 / particleSteps : 0.0);
+    std::printf("  \"pairs_tested\": %lld,\n", stats.pairsTested);
+    std::printf("  \"pairs_resolved\": %lld,\n", stats.pairsResolved);
+    std::printf("  \"awake_at_end\": %d,\n", solver.getAwakeCount());
+    std::printf("  \"paged_out_at_end\": %d,\n", solver.getPagedOutCount());
+    std::printf("  \"disorder_at_end\": %.3f,\n", solver.measureDisorder());
+    std::printf("  \"peak_rss_kb\": %lld\n", peakMemoryKb());
+    std::printf("}\n");
+    return 0;
+}
@@ -0,0 +1,43 @@
+#include "Camera.hpp"
+#include <algorithm>
+
+Camera::Camera(const sf::Vector2f& viewSize)
+{
+    view.setSize(viewSize);
+    view.setCenter(viewSize / 2.f);
+}
+
+void Camera::follow(const sf::Vector2f& target, const sf::RectangleShape& bounds)
+{
+    float outline = bounds.getOutlineThickness();
+    sf::Vector2f topLeft = bounds.getPosition() - bounds.getOrigin() - sf::Vector2f(outline, outline);
+    sf::Vector2f size = bounds.getSize() + sf::Vector2f(outline * 2.f, outline * 2.f);
+    sf::Vector2f half = view.getSize() / 2.f;
+
+    auto axis = [](float want, float low, float length, float halfView) {
+        if (length <= halfView * 2.f)
+            return low + length / 2.f;
+        return std::clamp(want, low + halfView, low + length - halfView);
+    };
+
+    view.setCenter({
+        axis(target.x, topLeft.x, size.x, half.x),
+        axis(target.y, topLeft.y, size.y, half.y)
+        });
+}
+
+const sf::View& Camera::getView() const
+{
+    return view;
+}
+
+sf::FloatRect Camera::getVisibleArea() const
+{
+    return getArea(0.f);
+}
+
+sf::FloatRect Camera::getArea(float margin) const
+{
+    sf::Vector2f half = view.getSize() / 2.f + sf::Vector2f(margin, margin);
+    return sf::FloatRect(view.getCenter() - half, half * 2.f);
+}
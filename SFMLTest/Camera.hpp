@@ -0,0 +1,25 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+/// <summary>
+/// View following the player over maps larger than the window.
+/// The view stays inside the level bounds, on an axis where the map is smaller than the view it is centred instead.
+/// It is moved from game state only, so a replay without a window sees the same camera.
+/// </summary>
+class Camera {
+public:
+    explicit Camera(const sf::Vector2f& viewSize = { 800.f, 800.f });
+
+    // Centres the view on target, kept inside bounds and its outline
+    void follow(const sf::Vector2f& target, const sf::RectangleShape& bounds);
+
+    const sf::View& getView() const;
+
+    // World area the view shows, and the same grown by margin on every side
+    sf::FloatRect getVisibleArea() const;
+    sf::FloatRect getArea(float margin) const;
+
+private:
+    sf::View view;
+};
@@ -1,9 +1,8 @@
 #include "Enemy.hpp"
 #include "Player.hpp"
-#include "Wall.hpp"
 #include "MathUtils.hpp"
+#include "Trace.hpp"
 
-#include <cstdlib>
 #include <cmath>
 //Constructor
 Enemy::Enemy(sf::Vector2f startPos_, int id_, Type t)
@@ -14,18 +13,9 @@ Enemy::Enemy(sf::Vector2f startPos_, int id_, Type t)
         type == Type::Moving ? sf::Color::Red : sf::Color::Blue
     );
     shape.setPosition(pos);
-
-    // Random offset inside map for following enemies
-    if (type == Type::Moving) {
-        float maxOffset = 10.f;
-        randomOffset = {
-            static_cast<float>((rand() % static_cast<int>(maxOffset)) - maxOffset / 2.f),
-            static_cast<float>((rand() % static_cast<int>(maxOffset)) - maxOffset / 2.f)
-        };
-    }
 }
 
-void Enemy::update(const std::vector<Wall>&,
+void Enemy::update(const TileGrid&,
     const sf::RectangleShape& worldBounds)
 {
     // Clamp enemy inside world bounds
@@ -35,8 +25,12 @@ void Enemy::update(const std::vector<Wall>&,
 
 void Enemy::updateAI(float dt, Player& player)
 {
-    static sf::Clock clock;
-    float time = clock.getElapsedTime().asSeconds();
+    TRACE_ZONE("Enemy::updateAI");
+
+    // timers advance with the frame time only, so a replayed frame sequence moves the same way
+    elapsed += dt;
+    damageTimer += dt;
+    float time = elapsed;
 
     sf::Vector2f playerPos = player.getPosition();
 
@@ -71,11 +65,10 @@ void Enemy::updateAI(float dt, Player& player)
         std::pow(playerPos.y - pos.y, 2.f)
     );
 
-    if (distance <= 30.f &&
-        damageClock.getElapsedTime().asSeconds() >= damageCooldown)
+    if (distance <= 30.f && damageTimer >= damageCooldown)
     {
         player.takeDamage(5);
-        damageClock.restart();
+        damageTimer = 0.f;
     }
 }
 
@@ -8,7 +8,6 @@
 
 // Forward declarations
 class Player;
-class Wall;
 
 class Enemy : public Entity {
 public:
@@ -20,7 +19,7 @@ public:
         Type type = Type::Moving);
 
     // Required by Entity (movement + collisions)
-    void update(const std::vector<Wall>& walls,
+    void update(const TileGrid& tiles,
         const sf::RectangleShape& worldBounds) override;
 
     // Enemy-specific logic (chasing + damage)
@@ -32,6 +31,9 @@ public:
     // Enemy.hpp
     void setColor(const sf::Color& color) { shape.setFillColor(color); }
 
+    // Where a following enemy aims relative to the player, rolled by the level builder
+    void setRandomOffset(const sf::Vector2f& offset) { randomOffset = offset; }
+
 
 private:
     Type type;
@@ -45,7 +47,10 @@ private:
 
     // Damage handling
     float damageCooldown = 1.f;
-    sf::Clock damageClock;
+    float damageTimer = 0.f;    // seconds since the last hit
+
+    // Seconds of game time since spawning, drives the movement patterns
+    float elapsed = 0.f;
 
     // Random movement offset
     sf::Vector2f randomOffset;
@@ -1,6 +1,8 @@
 #pragma once
 #include <SFML/Graphics.hpp>
 
+class TileGrid;
+
 // Base class for all game entities
 class Entity {
 public:
@@ -9,8 +11,8 @@ public:
     int health = 100;
     sf::RectangleShape body;
 
-    // Pure virtual update with walls & world bounds
-    virtual void update(const std::vector<class Wall>& walls,
+    // Pure virtual update with the solid tiles & world bounds
+    virtual void update(const TileGrid& tiles,
         const sf::RectangleShape& worldBounds) = 0;
 };
 
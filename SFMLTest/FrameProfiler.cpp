@@ -0,0 +1,229 @@
+// FrameProfiler.cpp
+#include "FrameProfiler.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    float millisecondsSince(Clock::time_point start) {
+        return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+    }
+
+    // one per phase in the order of FrameProfiler::Phase
+    const sf::Color phaseColors[] = {
+        sf::Color(200, 200, 200), sf::Color(120, 220, 255), sf::Color(0, 150, 255), sf::Color(255, 80, 80),
+        sf::Color(80, 220, 80), sf::Color(0, 200, 170), sf::Color(255, 220, 0), sf::Color(255, 150, 0),
+        sf::Color(170, 120, 255), sf::Color(90, 120, 255), sf::Color(140, 140, 140), sf::Color(70, 70, 90)
+    };
+    static_assert(sizeof(phaseColors) / sizeof(phaseColors[0]) == FrameProfiler::PhaseCount,
+        "every profiler phase needs a colour");
+}
+
+// ------------------- Scope -------------------
+
+FrameProfiler::Scope::Scope(FrameProfiler& profiler_, Phase phase_)
+    : profiler(profiler_), phase(phase_), start(Clock::now()) {}
+
+FrameProfiler::Scope::~Scope() {
+    profiler.addTime(phase, millisecondsSince(start));
+}
+
+// ------------------- FrameProfiler -------------------
+
+FrameProfiler::FrameProfiler(int capacity, float budgetMs_)
+    : samples(std::max(capacity, 1)), budgetMs(budgetMs_) {}
+
+void FrameProfiler::beginFrame() {
+    current = FrameSample();
+    frameStart = Clock::now();
+    inFrame = true;
+}
+
+void FrameProfiler::endFrame() {
+    if (!inFrame) return;
+
+    current.frameMs = millisecondsSince(frameStart);
+    samples[next] = current;
+    next = (next + 1) % static_cast<int>(samples.size());
+    count = std::min(count + 1, static_cast<int>(samples.size()));
+    inFrame = false;
+}
+
+void FrameProfiler::addTime(Phase phase, float ms) {
+    current.phaseMs[static_cast<int>(phase)] += ms;
+}
+
+// age 0 is the oldest buffered frame
+const FrameProfiler::FrameSample& FrameProfiler::sampleAt(int age) const {
+    int size = static_cast<int>(samples.size());
+    return samples[(next - count + age + size) % size];
+}
+
+// nearest rank, values get reordered
+float FrameProfiler::percentile(std::vector<float>& values, float fraction) const {
+    if (values.empty()) return 0.f;
+
+    size_t rank = static_cast<size_t>(fraction * (values.size() - 1) + 0.5f);
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+
+FrameProfiler::Summary FrameProfiler::summarize() const {
+    Summary summary;
+    summary.frames = count;
+    if (count == 0) return summary;
+
+    sortScratch.clear();
+    std::vector<float> work;
+    work.reserve(count);
+
+    for (int age = 0; age < count; ++age) {
+        const FrameSample& sample = sampleAt(age);
+
+        float workMs = 0.f;
+        for (int p = 0; p < PhaseCount; ++p) {
+            summary.phaseAverage[p] += sample.phaseMs[p];
+            if (p != static_cast<int>(Phase::Display))
+                workMs += sample.phaseMs[p];
+        }
+
+        summary.frameAverage += sample.frameMs;
+        if (sample.frameMs > budgetMs) ++summary.overBudget;
+        if (sample.frameMs > budgetMs * 1.5f) ++summary.stutters;
+
+        sortScratch.push_back(sample.frameMs);
+        work.push_back(workMs);
+    }
+
+    for (float& average : summary.phaseAverage)
+        average /= count;
+    summary.frameAverage /= count;
+
+    summary.frameP50 = percentile(sortScratch, 0.50f);
+    summary.frameP95 = percentile(sortScratch, 0.95f);
+    summary.frameP99 = percentile(sortScratch, 0.99f);
+    summary.workP99 = percentile(work, 0.99f);
+    return summary;
+}
+
+void FrameProfiler::clear() {
+    next = 0;
+    count = 0;
+    inFrame = false;
+}
+
+void FrameProfiler::toggleOverlay() { overlayVisible = !overlayVisible; }
+
+bool FrameProfiler::isOverlayVisible() const { return overlayVisible; }
+
+// the overlay works without a font, the bars are drawn either way
+void FrameProfiler::loadFont() {
+    fontTried = true;
+
+    const char* candidates[] = {
+        "font.ttf",
+        "C:/Windows/Fonts/consola.ttf",
+        "C:/Windows/Fonts/arial.ttf",
+        "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf",
+        "/System/Library/Fonts/Menlo.ttc"
+    };
+    for (const char* path : candidates) {
+        if (font.openFromFile(path)) {
+            fontLoaded = true;
+            return;
+        }
+    }
+}
+
+// one bar per phase scaled to its average, the frame budget is the full width
+void FrameProfiler::drawOverlay(sf::RenderTarget& target) {
+    if (!overlayVisible) return;
+    if (!fontTried) loadFont();
+
+    Summary summary = summarize();
+
+    const sf::Vector2f origin(10.f, 10.f);
+    const float rowHeight = 14.f;
+    const float labelWidth = fontLoaded ? 190.f : 0.f;
+    const float barWidth = 200.f;
+    const int rows = PhaseCount + 2;
+
+    sf::RectangleShape panel({ labelWidth + barWidth + 20.f, rows * rowHeight + 10.f });
+    panel.setPosition(origin - sf::Vector2f(5.f, 5.f));
+    panel.setFillColor(sf::Color(0, 0, 0, 170));
+    target.draw(panel);
+
+    auto drawLabel = [&](const std::string& label, float y) {
+        if (!fontLoaded) return;
+        sf::Text text(font, label, 11);
+        text.setPosition({ origin.x, y });
+        text.setFillColor(sf::Color::White);
+        target.draw(text);
+    };
+
+    char line[128];
+    for (int p = 0; p < PhaseCount; ++p) {
+        float y = origin.y + p * rowHeight;
+
+        sf::RectangleShape bar({ std::min(summary.phaseAverage[p] / budgetMs, 1.f) * barWidth, rowHeight - 3.f });
+        bar.setPosition({ origin.x + labelWidth, y + 1.f });
+        bar.setFillColor(phaseColors[p]);
+        target.draw(bar);
+
+        std::snprintf(line, sizeof(line), "%-14s %6.2f ms", getPhaseName(static_cast<Phase>(p)), summary.phaseAverage[p]);
+        drawLabel(line, y);
+    }
+
+    // whole frame against the budget, red once it is over
+    float y = origin.y + PhaseCount * rowHeight;
+    sf::RectangleShape frameBar({ std::min(summary.frameP99 / budgetMs, 1.f) * barWidth, rowHeight - 3.f });
+    frameBar.setPosition({ origin.x + labelWidth, y + 1.f });
+    frameBar.setFillColor(summary.frameP99 > budgetMs ? sf::Color::Red : sf::Color::White);
+    target.draw(frameBar);
+
+    std::snprintf(line, sizeof(line), "p50 %.1f p95 %.1f p99 %.1f ms", summary.frameP50, summary.frameP95, summary.frameP99);
+    drawLabel(line, y);
+    std::snprintf(line, sizeof(line), "over budget %d stutters %d / %d", summary.overBudget, summary.stutters, summary.frames);
+    drawLabel(line, y + rowHeight);
+}
+
+bool FrameProfiler::writeCsv(const std::string& path) const {
+    if (count == 0) return false;
+
+    std::ofstream file(path);
+    if (!file) return false;
+
+    file << "frame";
+    for (int p = 0; p < PhaseCount; ++p)
+        file << "," << getPhaseName(static_cast<Phase>(p));
+    file << ",total\n";
+
+    for (int age = 0; age < count; ++age) {
+        const FrameSample& sample = sampleAt(age);
+        file << age;
+        for (float ms : sample.phaseMs)
+            file << "," << ms;
+        file << "," << sample.frameMs << "\n";
+    }
+    return true;
+}
+
+const char* FrameProfiler::getPhaseName(Phase phase) {
+    switch (phase) {
+    case Phase::Events: return "events";
+    case Phase::Oxygen: return "oxygen";
+    case Phase::Particles: return "particles";
+    case Phase::Enemies: return "enemies";
+    case Phase::Player: return "player";
+    case Phase::Streaming: return "streaming";
+    case Phase::Pickups: return "pickups";
+    case Phase::Completion: return "completion";
+    case Phase::DrawWorld: return "draw_world";
+    case Phase::DrawParticles: return "draw_particles";
+    case Phase::DrawGrid: return "draw_grid";
+    case Phase::Display: return "display";
+    default: return "unknown";
+    }
+}
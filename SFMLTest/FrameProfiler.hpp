@@ -0,0 +1,104 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Times the phases of each frame with scoped timers and keeps the most recent frames in a ring buffer.
+/// Can summarise them as per phase averages and frame time percentiles, draw that as an overlay
+/// and write the buffered frames to a CSV file.
+/// </summary>
+class FrameProfiler {
+public:
+    enum class Phase {
+        Events,
+        Oxygen,
+        Particles,
+        Enemies,
+        Player,
+        Streaming,
+        Pickups,
+        Completion,
+        DrawWorld,
+        DrawParticles,
+        DrawGrid,
+        Display,    // includes the wait of the frame rate limit
+        Count
+    };
+
+    static constexpr int PhaseCount = static_cast<int>(Phase::Count);
+
+    // Adds the time from construction to destruction to a phase of the current frame
+    class Scope {
+    public:
+        Scope(FrameProfiler& profiler, Phase phase);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        FrameProfiler& profiler;
+        Phase phase;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    struct Summary {
+        int frames = 0;
+        std::array<float, PhaseCount> phaseAverage{};  // ms
+        float frameAverage = 0.f;
+        float frameP50 = 0.f;
+        float frameP95 = 0.f;
+        float frameP99 = 0.f;
+        float workP99 = 0.f;    // frame time without Display
+        int overBudget = 0;     // frames longer than the budget
+        int stutters = 0;       // frames longer than one and a half budgets
+    };
+
+    explicit FrameProfiler(int capacity = 600, float budgetMs = 1000.f / 60.f);
+
+    void beginFrame();
+    void endFrame();
+
+    Summary summarize() const;
+    void clear();
+
+    void toggleOverlay();
+    bool isOverlayVisible() const;
+    void drawOverlay(sf::RenderTarget& target);
+
+    // One row per buffered frame, oldest first. Returns false when nothing was written.
+    bool writeCsv(const std::string& path) const;
+
+    static const char* getPhaseName(Phase phase);
+
+private:
+    struct FrameSample {
+        std::array<float, PhaseCount> phaseMs{};
+        float frameMs = 0.f;
+    };
+
+    std::vector<FrameSample> samples;
+    int next = 0;
+    int count = 0;
+    float budgetMs;
+
+    FrameSample current;
+    std::chrono::steady_clock::time_point frameStart;
+    bool inFrame = false;
+
+    bool overlayVisible = false;
+    bool fontTried = false;
+    bool fontLoaded = false;
+    sf::Font font;
+
+    mutable std::vector<float> sortScratch;
+
+    void addTime(Phase phase, float ms);
+    const FrameSample& sampleAt(int age) const;
+    float percentile(std::vector<float>& values, float fraction) const;
+    void loadFont();
+};
@@ -1,8 +1,13 @@
 #pragma once
 #include <vector>
 #include "Player.hpp"
-#include "Wall.hpp"
 #include "Solver.hpp"
+#include "SolverThread.hpp"
+#include "ParticleRenderer.hpp"
+#include "StaticLayer.hpp"
+#include "FrameProfiler.hpp"
+#include "TileGrid.hpp"
+#include "Camera.hpp"
 
 // Holds all shared game state previously in globals
 struct GameData {
@@ -12,8 +17,30 @@ struct GameData {
     // Particle physics solver
     Solver particleSolver;
 
-    // Collection of walls
-    std::vector<Wall> walls;
+    // Steps particleSolver on its own thread while a level is played, when asyncPhysics is set
+    SolverThread solverThread{ particleSolver };
+    bool asyncPhysics = false;
+
+    // Draws all particles in one batch
+    ParticleRenderer particleRenderer;
+
+    // Walls and grid overlay, baked per chunk while the camera is near
+    StaticLayer staticLayer;
+
+    // View following the player, decides which chunks are resident and simulated
+    Camera camera;
+
+    // Solid tiles of the current map for wall collisions
+    TileGrid solidTiles;
+
+    // Per phase timings of the recent frames
+    FrameProfiler profiler;
+
+    // Seconds since oxygen was last used up, a tick happens every full second
+    float oxygenTimer = 0.f;
+
+    // Force emitter following the mouse while the button is held, -1 when there is none
+    int mouseEmitter = -1;
 
     // Flags
     bool isRendering = false;  // replaces openParticleSim
@@ -1,4 +1,5 @@
 #include "HallOfFame.hpp"
+#include "Trace.hpp"
 
 #include <fstream>
 #include <sstream>
@@ -9,6 +10,7 @@ HallOfFame::HallOfFame(const std::string& file)
 }
 
 void HallOfFame::load() {
+    TRACE_ZONE("HallOfFame::load");
     entries.clear();
 
     std::ifstream file(filename);
@@ -37,6 +39,7 @@ void HallOfFame::load() {
 }
 
 void HallOfFame::save() const {
+    TRACE_ZONE("HallOfFame::save");
     std::ofstream file(filename);
     if (!file.is_open()) return;
 
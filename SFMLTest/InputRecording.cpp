@@ -0,0 +1,169 @@
+// InputRecording.cpp
+#include "InputRecording.hpp"
+#include <cstring>
+#include <iostream>
+
+// file layout, all numbers little endian:
+//   "HDREC" version(u8) seed(u32) mapIndex(i32) dt(f32) customMapLength(u32) customMap(bytes)
+//   per frame: flags(u8) [mouseX(f32) mouseY(f32) when the mouse flag is set]
+namespace {
+    const char magic[5] = { 'H', 'D', 'R', 'E', 'C' };
+    // 2: maps start at the origin with the mouse in world coordinates and levels use the new spawn seeds,
+    // version 1 inputs would play out differently
+    const std::uint8_t version = 2;
+    // longer than any map path, a bigger length means the header is damaged
+    const std::uint32_t maxMapNameLength = 4096;
+
+    enum FrameFlags : std::uint8_t {
+        KeyUp = 1 << 0,
+        KeyDown = 1 << 1,
+        KeyLeft = 1 << 2,
+        KeyRight = 1 << 3,
+        MouseDown = 1 << 4
+    };
+
+    void writeU32(std::ostream& out, std::uint32_t value) {
+        char bytes[4];
+        for (int i = 0; i < 4; ++i)
+            bytes[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+        out.write(bytes, 4);
+    }
+
+    void writeFloat(std::ostream& out, float value) {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        writeU32(out, bits);
+    }
+
+    bool readU32(std::istream& in, std::uint32_t& value) {
+        unsigned char bytes[4];
+        if (!in.read(reinterpret_cast<char*>(bytes), 4)) return false;
+        value = 0;
+        for (int i = 0; i < 4; ++i)
+            value |= static_cast<std::uint32_t>(bytes[i]) << (8 * i);
+        return true;
+    }
+
+    bool readFloat(std::istream& in, float& value) {
+        std::uint32_t bits;
+        if (!readU32(in, bits)) return false;
+        std::memcpy(&value, &bits, sizeof(value));
+        return true;
+    }
+}
+
+// ------------------- InputRecorder -------------------
+
+bool InputRecorder::open(const std::string& path, const RecordingHeader& header) {
+    file.open(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Failed to open recording file: " << path << "\n";
+        return false;
+    }
+
+    file.write(magic, sizeof(magic));
+    file.put(static_cast<char>(version));
+    writeU32(file, header.seed);
+    writeU32(file, static_cast<std::uint32_t>(header.mapIndex));
+    writeFloat(file, header.dt);
+    writeU32(file, static_cast<std::uint32_t>(header.customMap.size()));
+    file.write(header.customMap.data(), header.customMap.size());
+
+    frameCount = 0;
+    return true;
+}
+
+void InputRecorder::record(const FrameInput& input) {
+    if (!file) return;
+
+    std::uint8_t flags = 0;
+    if (input.keys.up) flags |= KeyUp;
+    if (input.keys.down) flags |= KeyDown;
+    if (input.keys.left) flags |= KeyLeft;
+    if (input.keys.right) flags |= KeyRight;
+    if (input.mouseDown) flags |= MouseDown;
+
+    file.put(static_cast<char>(flags));
+    if (input.mouseDown) {
+        writeFloat(file, input.mouse.x);
+        writeFloat(file, input.mouse.y);
+    }
+    ++frameCount;
+}
+
+void InputRecorder::close() {
+    if (file.is_open())
+        file.close();
+}
+
+bool InputRecorder::isOpen() const { return file.is_open(); }
+
+int InputRecorder::getFrameCount() const { return frameCount; }
+
+// ------------------- InputReplay -------------------
+
+bool InputReplay::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open recording file: " << path << "\n";
+        return false;
+    }
+
+    char fileMagic[sizeof(magic)];
+    int fileVersion = 0;
+    if (!file.read(fileMagic, sizeof(fileMagic)) || std::memcmp(fileMagic, magic, sizeof(magic)) != 0) {
+        std::cerr << "Not a recording file: " << path << "\n";
+        return false;
+    }
+    if ((fileVersion = file.get()) != version) {
+        std::cerr << "Recording " << path << " has version " << fileVersion << ", this build plays version "
+            << static_cast<int>(version) << "\n";
+        return false;
+    }
+
+    std::uint32_t mapIndex = 0;
+    std::uint32_t nameLength = 0;
+    if (!readU32(file, header.seed) || !readU32(file, mapIndex) ||
+        !readFloat(file, header.dt) || !readU32(file, nameLength)) {
+        std::cerr << "Truncated recording header: " << path << "\n";
+        return false;
+    }
+    header.mapIndex = static_cast<std::int32_t>(mapIndex);
+
+    // check the length before allocating for it, a damaged header must not ask for gigabytes
+    const std::streampos nameStart = file.tellg();
+    file.seekg(0, std::ios::end);
+    const std::streamoff bytesLeft = file.tellg() - nameStart;
+    file.seekg(nameStart);
+    if (nameLength > maxMapNameLength || static_cast<std::streamoff>(nameLength) > bytesLeft) {
+        std::cerr << "Truncated recording header: " << path << "\n";
+        return false;
+    }
+    header.customMap.assign(nameLength, '\0');
+    if (nameLength > 0 && !file.read(&header.customMap[0], nameLength)) {
+        std::cerr << "Truncated recording header: " << path << "\n";
+        return false;
+    }
+
+    frames.clear();
+    int flags;
+    while ((flags = file.get()) != std::char_traits<char>::eof()) {
+        FrameInput input;
+        input.keys.up = (flags & KeyUp) != 0;
+        input.keys.down = (flags & KeyDown) != 0;
+        input.keys.left = (flags & KeyLeft) != 0;
+        input.keys.right = (flags & KeyRight) != 0;
+        input.mouseDown = (flags & MouseDown) != 0;
+
+        if (input.mouseDown && (!readFloat(file, input.mouse.x) || !readFloat(file, input.mouse.y))) {
+            std::cerr << "Recording ends in the middle of a frame, frames after " << frames.size() << " are lost\n";
+            break;
+        }
+        frames.push_back(input);
+    }
+    return true;
+}
+
+const RecordingHeader& InputReplay::getHeader() const { return header; }
+
+const std::vector<FrameInput>& InputReplay::getFrames() const { return frames; }
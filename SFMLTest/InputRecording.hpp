@@ -0,0 +1,56 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "Player.hpp"
+
+// Everything the game loop reads from the player during one frame
+struct FrameInput {
+    Player::Input keys;
+    bool mouseDown = false;
+    sf::Vector2f mouse;     // world position under the cursor, the camera is already applied
+};
+
+// What has to be the same before the first frame for a replay to match the recording
+struct RecordingHeader {
+    std::uint32_t seed = 0;
+    std::int32_t mapIndex = 0;
+    std::string customMap;   // empty for the built in maps
+    float dt = 1.f / 60.f;   // fixed frame time of every recorded frame
+};
+
+/// <summary>
+/// Writes the header and then one record per frame to a binary file.
+/// A frame is one byte of flags, the mouse position is only stored while the button is held.
+/// </summary>
+class InputRecorder {
+public:
+    bool open(const std::string& path, const RecordingHeader& header);
+    void record(const FrameInput& input);
+    void close();
+
+    bool isOpen() const;
+    int getFrameCount() const;
+
+private:
+    std::ofstream file;
+    int frameCount = 0;
+};
+
+/// <summary>
+/// Reads a file written by InputRecorder back in to memory.
+/// </summary>
+class InputReplay {
+public:
+    bool load(const std::string& path);
+
+    const RecordingHeader& getHeader() const;
+    const std::vector<FrameInput>& getFrames() const;
+
+private:
+    RecordingHeader header;
+    std::vector<FrameInput> frames;
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <SFML/Graphics.hpp>
+#include <memory>
 #include "Player.hpp" // include the Player class for applyEffect
 
 /// <summary>
@@ -20,4 +21,7 @@ public:
 
     // Effect applied when player collects the item
     virtual void applyEffect(Player& player) = 0;
+
+    // Copy of the item as it is now, used to keep the initial state of a level
+    virtual std::unique_ptr<Item> clone() const = 0;
 };
@@ -13,6 +13,10 @@ public:
         player.health = std::min(player.health + 5, 100);
         collected = true;
     }
+
+    std::unique_ptr<Item> clone() const override {
+        return std::make_unique<HydraMineral>(*this);
+    }
 };
 
 class Oxygen : public Item {
@@ -25,4 +29,8 @@ public:
         player.oxygenTime = std::min(player.oxygenTime + 10.f, 30.f);
         collected = true;
     }
+
+    std::unique_ptr<Item> clone() const override {
+        return std::make_unique<Oxygen>(*this);
+    }
 };
@@ -1,7 +1,9 @@
 #include "Level.hpp"
-#include <fstream>
+#include <algorithm>
 #include <iostream>
+#include <utility>
 #include "LevelBuilder.hpp"
+#include "Trace.hpp"
 
 // Treasure helpers
 
@@ -34,16 +36,8 @@ int& Level::addCollectedToTotal(Player& player) {
 
 void Level::freeMap()
 {
-    if (map != nullptr) {
-        for (int i = 0; i < rows; ++i)
-            delete[] map[i];
-
-        delete[] map;
-        map = nullptr;
-    }
-
-    rows = 0;
-    cols = 0;
+    map.clear();
+    spawns.clear();
 
     enemies.clear();
     items.clear();
@@ -53,51 +47,134 @@ void Level::freeMap()
 
 void Level::load(GameData& gameData, Enemy& enemy)
 {
+    TRACE_ZONE("Level::load");
+
     // Reset player & treasures
     reset(gameData, enemy);
 
     // Determine filename
-    std::string filename;
-    if (customMapFile) {
-        filename = customMapFileName;
+    std::string filename = currentMapPath();
+    if (filename.empty()) {
+        std::cerr << "Invalid map index\n";
+        return;
+    }
+
+    // A level played before is copied from its initial state, otherwise the prefetched world
+    // is taken or it is built right here
+    std::uint32_t seed = levelSeed(filename);
+    if (const LevelWorld* initial = findInitialState(filename, seed)) {
+        staging.copyFrom(*initial);
     }
     else {
-        if (currentMapIndex < 0 || currentMapIndex >= mapFiles.size()) {
-            std::cerr << "Invalid map index\n";
-            return;
+        float gridCellSize = gameData.particleSolver.getGridCellSize();
+        if (!prefetcher.take(filename, seed, staging)) {
+            std::string error;
+            staging.mapPath = filename;
+            if (!LevelBuilder::build(staging, gridCellSize, seed, error)) {
+                std::cerr << "Failed to load map file " << filename << ": " << error << "\n";
+                staging.clear();
+                return;
+            }
         }
-        filename = mapFiles[currentMapIndex];
+        keepInitialState(staging);
     }
 
-    std::ifstream file(filename);
-    if (!file) {
-        std::cerr << "Failed to open map file: " << filename << "\n";
-        return;
-    }
+    install(staging, gameData);
+    prefetchNeighbours(gameData);
+}
 
-    std::vector<std::string> contents;
-    std::string line;
-    while (std::getline(file, line))
-        contents.push_back(line);
+void Level::install(LevelWorld& world, GameData& gameData)
+{
+    TRACE_ZONE("Level::install");
 
-    if (contents.empty()) {
-        std::cerr << "Empty map file\n";
-        return;
+    std::swap(map, world.map);
+    std::swap(spawns, world.spawns);
+    std::swap(enemies, world.enemies);
+    std::swap(items, world.items);
+    bounds = world.bounds;
+
+    std::swap(gameData.solidTiles, world.solidTiles);
+    gameData.staticLayer.swapGeometry(world.staticLayer);
+    gameData.particleSolver.setTileGrid(&gameData.solidTiles);
+
+    // the solver keeps its own arrays, the particles are copied over in bulk
+    gameData.particleSolver.assignObjects(world.particlePositions, world.particleRadii);
+
+    if (world.hasPlayerStart)
+        gameData.player.setPosition(world.playerStart);
+
+    // the old level came back in the swaps
+    world.clear();
+}
+
+std::string Level::currentMapPath() const
+{
+    if (customMapFile)
+        return customMapFileName;
+    if (currentMapIndex < 0 || currentMapIndex >= static_cast<int>(mapFiles.size()))
+        return {};
+    return mapFiles[currentMapIndex];
+}
+
+// FNV-1a of the path mixed in to the seed, restarting a map builds it the same way every time
+std::uint32_t Level::levelSeed(const std::string& mapPath) const
+{
+    std::uint32_t hash = 2166136261u ^ spawnSeed;
+    for (char c : mapPath) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 16777619u;
     }
+    return hash;
+}
+
+// the abort menu can go back one map and completing a level goes forward one
+std::vector<std::string> Level::neighbourMapPaths() const
+{
+    std::vector<std::string> neighbours;
+    if (currentMapIndex > 0 && currentMapIndex - 1 < static_cast<int>(mapFiles.size()))
+        neighbours.push_back(mapFiles[currentMapIndex - 1]);
+    if (currentMapIndex >= 0 && currentMapIndex + 1 < static_cast<int>(mapFiles.size()))
+        neighbours.push_back(mapFiles[currentMapIndex + 1]);
+    return neighbours;
+}
 
-    rows = static_cast<int>(contents.size());
-    cols = static_cast<int>(contents[0].size());
+// neighbours that have been played already have an initial state, only the others are built ahead
+void Level::prefetchNeighbours(const GameData& gameData)
+{
+    if (!prefetchEnabled) return;
+
+    std::vector<std::string> neighbours = neighbourMapPaths();
+    prefetcher.retain(neighbours);
+    float gridCellSize = gameData.particleSolver.getGridCellSize();
+    for (const std::string& path : neighbours) {
+        std::uint32_t seed = levelSeed(path);
+        if (!findInitialState(path, seed))
+            prefetcher.request(path, seed, gridCellSize);
+    }
+}
 
-    // Allocate map
-    map = new char* [rows];
-    for (int i = 0; i < rows; ++i) {
-        map[i] = new char[cols];
-        for (int j = 0; j < cols; ++j)
-            map[i][j] = contents[i][j];
+const LevelWorld* Level::findInitialState(const std::string& mapPath, std::uint32_t seed) const
+{
+    for (const auto& initial : initialStates) {
+        if (initial->mapPath == mapPath && initial->seed == seed)
+            return initial.get();
     }
+    return nullptr;
+}
 
-    // Build level using GameData
-    LevelBuilder::build(*this, enemy, gameData);
+// only the current level and its neighbours are kept so huge maps do not pile up in memory
+void Level::keepInitialState(const LevelWorld& world)
+{
+    std::vector<std::string> keep = neighbourMapPaths();
+    keep.push_back(world.mapPath);
+    initialStates.erase(std::remove_if(initialStates.begin(), initialStates.end(),
+        [&keep](const std::unique_ptr<LevelWorld>& initial) {
+            return std::find(keep.begin(), keep.end(), initial->mapPath) == keep.end();
+        }), initialStates.end());
+
+    auto initial = std::make_unique<LevelWorld>();
+    initial->copyFrom(world);
+    initialStates.push_back(std::move(initial));
 }
 
 void Level::reset(GameData& gameData, Enemy& enemy)
@@ -109,9 +186,10 @@ void Level::reset(GameData& gameData, Enemy& enemy)
     // Free previous map
     freeMap();
 
-    // Clear walls/items/enemies/particles
-    gameData.walls.clear();
+    // Clear tiles/items/enemies/particles
+    gameData.staticLayer.clear();
+    gameData.solidTiles.clear();
     enemies.clear();
     items.clear();
-    gameData.particleSolver.getObjects().clear();
+    gameData.particleSolver.clear();
 }
@@ -3,12 +3,17 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <cstdint>
 #include <SFML/Graphics.hpp>
 
 #include "Item.hpp"
 #include "Enemy.hpp"
 #include "Player.hpp"
 #include "GameData.hpp" 
+#include "TileMap.hpp"
+#include "LevelCache.hpp"
+#include "LevelWorld.hpp"
+#include "LevelPrefetcher.hpp"
 
 // has data that each level needs and has the reset / free and and load functions
 class Level {
@@ -24,18 +29,40 @@ public:
     int currentMapIndex = 0;
     bool requestCloseRender = false;
 
-    char** map = nullptr;
-    int rows = 0;
-    int cols = 0;
+    TileMap map;
+    LevelSpawns spawns;
+
+    // Seeds the random spawn offsets, mixed with the map path so every map gets its own sequence
+    std::uint32_t spawnSeed = 1;
+
+    // Builds the maps before and after the current one in the background while it is played
+    bool prefetchEnabled = true;
 
     // ------------------- Updated to use GameData -------------------
     void load(GameData& gameData, Enemy& enemy);
     void reset(GameData& gameData, Enemy& enemy);
     void freeMap();
 
+    // Moves a built world in to the level and the game, world gets the old buffers back empty
+    void install(LevelWorld& world, GameData& gameData);
+
     int getTotalTreasures() const;
     int getCollectedTreasures() const;
     void resetCollectedTreasures();
 
     int& addCollectedToTotal(Player& player);
+
+private:
+    LevelWorld staging;          // the next world is built or taken in to this one
+    LevelPrefetcher prefetcher;
+
+    // Each level as it was right after building, restarting copies it back instead of building again
+    std::vector<std::unique_ptr<LevelWorld>> initialStates;
+
+    std::string currentMapPath() const;
+    std::uint32_t levelSeed(const std::string& mapPath) const;
+    std::vector<std::string> neighbourMapPaths() const;
+    void prefetchNeighbours(const GameData& gameData);
+    const LevelWorld* findInitialState(const std::string& mapPath, std::uint32_t seed) const;
+    void keepInitialState(const LevelWorld& world);
 };
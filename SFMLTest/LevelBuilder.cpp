@@ -1,89 +1,138 @@
 #include "LevelBuilder.hpp"
 #include "Items.hpp"
-#include "Solver.hpp"
-#include "Wall.hpp"
-#include "GameData.hpp"  
-
-#include <fstream>
-#include <cstdlib> // rand()
+#include "Trace.hpp"
 
 // ----------------------------------------------------
 
-void LevelBuilder::build(Level& level, Enemy& enemy, GameData& gameData) 
+bool LevelBuilder::build(LevelWorld& world, float gridCellSize, std::uint32_t seed, std::string& error)
 {
-    clearWorldState(gameData);
-    setupBounds(level);
-    parseMap(level, enemy, gameData);
+    TRACE_ZONE("LevelBuilder::build");
+
+    std::string mapPath = world.mapPath;
+    clearWorldState(world);
+    world.mapPath = mapPath;
+    world.seed = seed;
+
+    // Compiled level when the cache is up to date, otherwise the text map is parsed and cached
+    if (!LevelCache::loadOrCompile(world.mapPath, world.map, world.spawns, error))
+        return false;
+
+    // mt19937 gives the same numbers with every compiler, rand() does not and is shared by all threads
+    std::mt19937 random(seed);
+
+    setupBounds(world);
+    setupTiles(world);
+    reserveParticles(world);
+    parseMap(world, random);
+    setupStaticLayer(world, gridCellSize);
+    return true;
 }
 
 // ----------------------------------------------------
 
-void LevelBuilder::clearWorldState(GameData& gameData) // clearing the earlier map 
+void LevelBuilder::clearWorldState(LevelWorld& world) // clearing the earlier map
 {
-    gameData.particleSolver.getObjects().clear();
-    gameData.walls.clear();
+    world.clear();
 }
 
 // ----------------------------------------------------
 
-void LevelBuilder::setupBounds(Level& level) 
+void LevelBuilder::setupBounds(LevelWorld& world)
 {
     const float cellSize = 20.f;
-    const float width = 840.f;
-    const float height = 840.f;
 
-    level.bounds.setSize({
-        level.cols * cellSize,
-        level.rows * cellSize
+    // the map starts at the world origin whatever its size, the camera scrolls over it
+    world.bounds.setSize({
+        world.map.getCols() * cellSize,
+        world.map.getRows() * cellSize
         });
 
-    level.bounds.setOrigin(level.bounds.getSize() / 2.f);
-    level.bounds.setPosition(sf::Vector2f(width / 2.f, height / 2.f));
+    world.bounds.setOrigin(world.bounds.getSize() / 2.f);
+    world.bounds.setPosition(world.bounds.getSize() / 2.f);
 
-    level.bounds.setFillColor(sf::Color::Black);
-    level.bounds.setOutlineThickness(5.f);
-    level.bounds.setOutlineColor(sf::Color::Blue);
+    world.bounds.setFillColor(sf::Color::Black);
+    world.bounds.setOutlineThickness(5.f);
+    world.bounds.setOutlineColor(sf::Color::Blue);
 }
 
-// after reading the text file map putting each element on their right place on SMFL screen
+// ----------------------------------------------------
+
+// solid tile lookup for the walls, the player and the particles collide with it and the static layer draws it
 
-void LevelBuilder::parseMap(Level& level, Enemy& enemy, GameData& gameData)
+void LevelBuilder::setupTiles(LevelWorld& world)
 {
     const float cellSize = 20.f;
-    const int particlesPerCell = 3;
+    sf::Vector2f topLeft = world.bounds.getPosition() - world.bounds.getSize() / 2.f;
 
-    for (int row = 0; row < level.rows; ++row)
-    {
-        for (int col = 0; col < level.cols; ++col)
-        {
-            char cell = level.map[row][col];
-            sf::Vector2f pos = cellToWorld(level, row, col, cellSize);
-
-            switch (cell)
-            {
-            case 'x': spawnWall(gameData, pos, cellSize); break;
-            case 'B': level.items.push_back(std::make_unique<HydraMineral>(pos)); break;
-            case 'O': level.items.push_back(std::make_unique<Oxygen>(pos)); break;
-            case 'o': spawnParticles(gameData, pos, particlesPerCell); break;
-            case 'P': gameData.player.setPosition(pos); break;
-            case 'E': spawnEnemy(level, pos, Enemy::Type::Moving); break;
-            case 'S': spawnEnemy(level, pos, Enemy::Type::Oscillating); break;
-            default: break;
-            }
-        }
+    world.solidTiles.build(world.map, topLeft, cellSize);
+}
+
+// ----------------------------------------------------
+
+// the particle arrays are sized once for all water of the map, the solver is reserved from them on install
+
+void LevelBuilder::reserveParticles(LevelWorld& world)
+{
+    std::size_t count = world.spawns.water.size() * particlesPerCell;
+    world.particlePositions.reserve(count);
+    world.particleRadii.reserve(count);
+}
+
+// putting each element of the resolved spawn lists on their right place on SMFL screen
+
+void LevelBuilder::parseMap(LevelWorld& world, std::mt19937& random)
+{
+    TRACE_ZONE("LevelBuilder::parseMap");
+
+    const float cellSize = 20.f;
+    const TileMap& map = world.map;
+    const LevelSpawns& spawns = world.spawns;
+
+    for (std::uint32_t tile : spawns.items) {
+        sf::Vector2f pos = tileToWorld(world, tile, cellSize);
+        if (map.data()[tile] == 'B')
+            world.items.push_back(std::make_unique<HydraMineral>(pos));
+        else
+            world.items.push_back(std::make_unique<Oxygen>(pos));
+    }
+
+    if (spawns.player >= 0) {
+        world.hasPlayerStart = true;
+        world.playerStart = tileToWorld(world, static_cast<std::uint32_t>(spawns.player), cellSize);
+    }
+
+    for (std::uint32_t tile : spawns.enemies) {
+        Enemy::Type type = map.data()[tile] == 'E' ? Enemy::Type::Moving : Enemy::Type::Oscillating;
+        spawnEnemy(world, tileToWorld(world, tile, cellSize), type, random);
     }
+
+    for (std::uint32_t tile : spawns.water)
+        spawnParticles(world, tileToWorld(world, tile, cellSize), particlesPerCell, random);
 }
 
+// ----------------------------------------------------
 
+// walls never move, they are baked per chunk from the tile grid once the camera gets near
+
+void LevelBuilder::setupStaticLayer(LevelWorld& world, float gridCellSize)
+{
+    world.staticLayer.build(world.solidTiles, gridCellSize);
+}
+
+sf::Vector2f LevelBuilder::tileToWorld(const LevelWorld& world, std::uint32_t tile, float cellSize)
+{
+    int cols = world.map.getCols();
+    return cellToWorld(world, static_cast<int>(tile / cols), static_cast<int>(tile % cols), cellSize);
+}
 
 sf::Vector2f LevelBuilder::cellToWorld(
-    const Level& level,
+    const LevelWorld& world,
     int row,
     int col,
     float cellSize)
 {
     sf::Vector2f topLeft =
-        level.bounds.getPosition() - level.bounds.getSize() / 2.f;
+        world.bounds.getPosition() - world.bounds.getSize() / 2.f;
 
     return {
         topLeft.x + col * cellSize + cellSize / 2.f,
@@ -93,34 +142,33 @@ sf::Vector2f LevelBuilder::cellToWorld(
 
 
 
-void LevelBuilder::spawnWall(GameData& gameData, const sf::Vector2f& pos, float size)
-{
-    gameData.walls.emplace_back(pos.x, pos.y, size, size);
-}
-
-
-
-void LevelBuilder::spawnEnemy(Level& level, const sf::Vector2f& pos, Enemy::Type type)
+void LevelBuilder::spawnEnemy(LevelWorld& world, const sf::Vector2f& pos, Enemy::Type type, std::mt19937& random)
 {
-    int id = static_cast<int>(level.enemies.size());
-    level.enemies.emplace_back(pos, id, type);
+    int id = static_cast<int>(world.enemies.size());
+    world.enemies.emplace_back(pos, id, type);
+
+    // Random offset inside map for following enemies
+    if (type == Enemy::Type::Moving) {
+        const int maxOffset = 10;
+        float offsetX = static_cast<float>(static_cast<int>(random() % maxOffset)) - maxOffset / 2.f;
+        float offsetY = static_cast<float>(static_cast<int>(random() % maxOffset)) - maxOffset / 2.f;
+        world.enemies.back().setRandomOffset({ offsetX, offsetY });
+    }
 
     if (type == Enemy::Type::Oscillating)
-        level.enemies.back().setColor(sf::Color(255, 105, 180));
+        world.enemies.back().setColor(sf::Color(255, 105, 180));
 }
 
 
 
-void LevelBuilder::spawnParticles(GameData& gameData, const sf::Vector2f& pos, int count)
+void LevelBuilder::spawnParticles(LevelWorld& world, const sf::Vector2f& pos, int count, std::mt19937& random)
 {
     for (int i = 0; i < count; ++i)
     {
-        float offsetX = static_cast<float>(rand() % 16 - 8);
-        float offsetY = static_cast<float>(rand() % 16 - 8);
+        float offsetX = static_cast<float>(static_cast<int>(random() % 16) - 8);
+        float offsetY = static_cast<float>(static_cast<int>(random() % 16) - 8);
 
-        gameData.particleSolver.addObject(
-            { pos.x + offsetX, pos.y + offsetY },
-            7.f
-        );
+        world.particlePositions.push_back({ pos.x + offsetX, pos.y + offsetY });
+        world.particleRadii.push_back(7.f);
     }
 }
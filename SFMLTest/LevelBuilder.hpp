@@ -1,29 +1,37 @@
 #pragma once
 
-#include "Level.hpp"
+#include <cstdint>
+#include <random>
+#include <string>
+#include "LevelWorld.hpp"
 #include "Enemy.hpp"
-#include "GameData.hpp" 
 
 class LevelBuilder
 {
 public:
-    // Build the level using GameData instead of globals
-    static void build(Level& level, Enemy& enemy, GameData& gameData);
+    // Build the level of world.mapPath in to world. Touches nothing else, so it can run on any thread.
+    // Random spawn offsets come from seed only, the same seed always builds the same level.
+    static bool build(LevelWorld& world, float gridCellSize, std::uint32_t seed, std::string& error);
 
 private:
     // Internal helpers
-    static void clearWorldState(GameData& gameData);
-    static void setupBounds(Level& level);
+    static void clearWorldState(LevelWorld& world);
+    static void setupBounds(LevelWorld& world);
+    static void setupTiles(LevelWorld& world);
+    static void reserveParticles(LevelWorld& world);
 
-    static void parseMap(Level& level, Enemy& enemy, GameData& gameData);
+    static void parseMap(LevelWorld& world, std::mt19937& random);
+    static void setupStaticLayer(LevelWorld& world, float gridCellSize);
+    static sf::Vector2f tileToWorld(const LevelWorld& world, std::uint32_t tile, float cellSize);
     static sf::Vector2f cellToWorld(
-        const Level& level,
+        const LevelWorld& world,
         int row,
         int col,
         float cellSize
     );
 
-    static void spawnWall(GameData& gameData, const sf::Vector2f& pos, float size);
-    static void spawnEnemy(Level& level, const sf::Vector2f& pos, Enemy::Type type);
-    static void spawnParticles(GameData& gameData, const sf::Vector2f& pos, int count);
+    static void spawnEnemy(LevelWorld& world, const sf::Vector2f& pos, Enemy::Type type, std::mt19937& random);
+    static void spawnParticles(LevelWorld& world, const sf::Vector2f& pos, int count, std::mt19937& random);
+
+    static constexpr int particlesPerCell = 3;
 };
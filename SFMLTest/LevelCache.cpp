@@ -0,0 +1,265 @@
+#include "LevelCache.hpp"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+
+// file layout, numbers in host byte order:
+//   "HDLVL" version(u8) byteOrder(u32) sourceSize(u64) sourceTime(i64)
+//   rows(i32) cols(i32) player(i32) itemCount(u32) enemyCount(u32) waterCount(u32)
+//   tiles(rows * cols bytes) items(u32...) enemies(u32...) water(u32...)
+// version 1 also stored a wall list
+namespace {
+    const char magic[5] = { 'H', 'D', 'L', 'V', 'L' };
+    const std::uint8_t version = 2;
+    const std::uint32_t byteOrder = 0x01020304;
+
+    struct Header {
+        std::uint64_t sourceSize = 0;
+        std::int64_t sourceTime = 0;
+        std::int32_t rows = 0;
+        std::int32_t cols = 0;
+        std::int32_t player = -1;
+        std::uint32_t itemCount = 0;
+        std::uint32_t enemyCount = 0;
+        std::uint32_t waterCount = 0;
+    };
+
+    const std::size_t headerSize = sizeof(magic) + 1 + 4 + 8 + 8 + 3 * 4 + 3 * 4;
+
+    // size and modification time of the text map, what a cache is checked against
+    bool sourceStamp(const std::string& mapPath, std::uint64_t& size, std::int64_t& time) {
+        std::error_code ec;
+        auto fileSize = std::filesystem::file_size(mapPath, ec);
+        if (ec) return false;
+        auto fileTime = std::filesystem::last_write_time(mapPath, ec);
+        if (ec) return false;
+
+        size = static_cast<std::uint64_t>(fileSize);
+        time = static_cast<std::int64_t>(fileTime.time_since_epoch().count());
+        return true;
+    }
+
+    template <typename T>
+    void put(std::vector<char>& out, const T& value) {
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    void putList(std::vector<char>& out, const std::vector<std::uint32_t>& list) {
+        const char* bytes = reinterpret_cast<const char*>(list.data());
+        out.insert(out.end(), bytes, bytes + list.size() * sizeof(std::uint32_t));
+    }
+
+    // Reads forward through the cache buffer, every read checks there are enough bytes left
+    class Reader {
+    public:
+        Reader(const char* data_, std::size_t size_) : data(data_), size(size_) {}
+
+        template <typename T>
+        bool get(T& value) {
+            if (size - offset < sizeof(T)) return false;
+            std::memcpy(&value, data + offset, sizeof(T));
+            offset += sizeof(T);
+            return true;
+        }
+
+        bool getList(std::vector<std::uint32_t>& list, std::uint32_t count) {
+            std::size_t bytes = static_cast<std::size_t>(count) * sizeof(std::uint32_t);
+            if (size - offset < bytes) return false;
+            list.resize(count);
+            std::memcpy(list.data(), data + offset, bytes);
+            offset += bytes;
+            return true;
+        }
+
+        const char* take(std::size_t bytes) {
+            if (size - offset < bytes) return nullptr;
+            const char* start = data + offset;
+            offset += bytes;
+            return start;
+        }
+
+        bool atEnd() const { return offset == size; }
+
+    private:
+        const char* data;
+        std::size_t size;
+        std::size_t offset = 0;
+    };
+
+    // every index has to be inside the map and point at the tile it claims to be
+    bool validList(const std::vector<std::uint32_t>& list, const TileMap& map, const char* kinds) {
+        std::size_t tileCount = static_cast<std::size_t>(map.getRows()) * map.getCols();
+        for (std::uint32_t index : list) {
+            if (index >= tileCount || map.data()[index] == 0 || !std::strchr(kinds, map.data()[index]))
+                return false;
+        }
+        return true;
+    }
+}
+
+// ------------------- LevelSpawns -------------------
+
+void LevelSpawns::resolve(const TileMap& map)
+{
+    clear();
+
+    std::uint32_t count = static_cast<std::uint32_t>(map.getRows()) * map.getCols();
+    const char* tiles = map.data();
+    for (std::uint32_t i = 0; i < count; ++i) {
+        switch (tiles[i]) {
+        case 'B':
+        case 'O': items.push_back(i); break;
+        case 'E':
+        case 'S': enemies.push_back(i); break;
+        case 'o': water.push_back(i); break;
+        case 'P': player = static_cast<std::int32_t>(i); break;
+        default: break;
+        }
+    }
+}
+
+void LevelSpawns::clear()
+{
+    items.clear();
+    enemies.clear();
+    water.clear();
+    player = -1;
+}
+
+// ------------------- LevelCache -------------------
+
+std::string LevelCache::getCachePath(const std::string& mapPath)
+{
+    return mapPath + ".cache";
+}
+
+bool LevelCache::load(const std::string& mapPath, TileMap& map, LevelSpawns& spawns)
+{
+    std::uint64_t sourceSize;
+    std::int64_t sourceTime;
+    if (!sourceStamp(mapPath, sourceSize, sourceTime))
+        return false;
+
+    std::ifstream file(getCachePath(mapPath), std::ios::binary | std::ios::ate);
+    if (!file) return false;
+
+    // the whole cache in one read
+    std::streamoff fileSize = file.tellg();
+    if (fileSize < static_cast<std::streamoff>(headerSize)) return false;
+    std::vector<char> buffer(static_cast<std::size_t>(fileSize));
+    file.seekg(0, std::ios::beg);
+    if (!file.read(buffer.data(), fileSize)) return false;
+
+    Reader in(buffer.data(), buffer.size());
+    const char* fileMagic = in.take(sizeof(magic));
+    std::uint8_t fileVersion = 0;
+    std::uint32_t fileByteOrder = 0;
+    Header header;
+    if (std::memcmp(fileMagic, magic, sizeof(magic)) != 0 ||
+        !in.get(fileVersion) || fileVersion != version ||
+        !in.get(fileByteOrder) || fileByteOrder != byteOrder)
+        return false;
+
+    if (!in.get(header.sourceSize) || !in.get(header.sourceTime) ||
+        !in.get(header.rows) || !in.get(header.cols) || !in.get(header.player) ||
+        !in.get(header.itemCount) || !in.get(header.enemyCount) || !in.get(header.waterCount))
+        return false;
+
+    // the text map was edited after the cache was made
+    if (header.sourceSize != sourceSize || header.sourceTime != sourceTime)
+        return false;
+
+    if (header.rows <= 0 || header.cols <= 0)
+        return false;
+    const char* tiles = in.take(static_cast<std::size_t>(header.rows) * static_cast<std::size_t>(header.cols));
+    if (!tiles) return false;
+
+    map.assign(header.rows, header.cols, tiles);
+    spawns.clear();
+    spawns.player = header.player;
+    bool valid =
+        in.getList(spawns.items, header.itemCount) &&
+        in.getList(spawns.enemies, header.enemyCount) &&
+        in.getList(spawns.water, header.waterCount) &&
+        in.atEnd();
+
+    // a damaged cache must not put anything outside the map
+    valid = valid &&
+        validList(spawns.items, map, "BO") && validList(spawns.enemies, map, "ES") &&
+        validList(spawns.water, map, "o") &&
+        (spawns.player < 0 || validList({ static_cast<std::uint32_t>(spawns.player) }, map, "P"));
+
+    if (!valid) {
+        map.clear();
+        spawns.clear();
+    }
+    return valid;
+}
+
+bool LevelCache::save(const std::string& mapPath, const TileMap& map, const LevelSpawns& spawns)
+{
+    Header header;
+    if (!sourceStamp(mapPath, header.sourceSize, header.sourceTime))
+        return false;
+
+    header.rows = map.getRows();
+    header.cols = map.getCols();
+    header.player = spawns.player;
+    header.itemCount = static_cast<std::uint32_t>(spawns.items.size());
+    header.enemyCount = static_cast<std::uint32_t>(spawns.enemies.size());
+    header.waterCount = static_cast<std::uint32_t>(spawns.water.size());
+
+    std::vector<char> out;
+    out.reserve(headerSize + static_cast<std::size_t>(header.rows) * header.cols +
+        (spawns.items.size() + spawns.enemies.size() + spawns.water.size()) * 4);
+
+    out.insert(out.end(), magic, magic + sizeof(magic));
+    put(out, version);
+    put(out, byteOrder);
+    put(out, header.sourceSize);
+    put(out, header.sourceTime);
+    put(out, header.rows);
+    put(out, header.cols);
+    put(out, header.player);
+    put(out, header.itemCount);
+    put(out, header.enemyCount);
+    put(out, header.waterCount);
+    out.insert(out.end(), map.data(), map.data() + static_cast<std::size_t>(header.rows) * header.cols);
+    putList(out, spawns.items);
+    putList(out, spawns.enemies);
+    putList(out, spawns.water);
+
+    std::string path = getCachePath(mapPath);
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file || !file.write(out.data(), static_cast<std::streamsize>(out.size())))
+            return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(temporary, path, ec);
+    if (ec) {
+        std::filesystem::remove(temporary, ec);
+        return false;
+    }
+    return true;
+}
+
+bool LevelCache::loadOrCompile(const std::string& mapPath, TileMap& map, LevelSpawns& spawns, std::string& error)
+{
+    if (load(mapPath, map, spawns))
+        return true;
+
+    if (!map.loadFromFile(mapPath, error))
+        return false;
+    spawns.resolve(map);
+
+    // a read only folder only costs the next load a parse again
+    if (!save(mapPath, map, spawns))
+        std::cerr << "Could not write level cache for " << mapPath << "\n";
+    return true;
+}
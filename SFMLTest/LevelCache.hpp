@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "TileMap.hpp"
+
+// Tiles that spawn something, as row-major tile indices in map order.
+// The map character at the index tells what kind of item or enemy it is.
+// Walls are no list, they are read from the tiles through a TileGrid.
+struct LevelSpawns {
+    std::vector<std::uint32_t> items;     // 'B' and 'O'
+    std::vector<std::uint32_t> enemies;   // 'E' and 'S'
+    std::vector<std::uint32_t> water;     // 'o', particlesPerCell particles each
+    std::int32_t player = -1;             // last 'P' of the map, -1 when there is none
+
+    // Collects the spawn lists of a parsed map, vectors keep their capacity between levels
+    void resolve(const TileMap& map);
+    void clear();
+};
+
+/// <summary>
+/// Compiled levels stored next to the text map as "<map>.cache": the tile grid plus the resolved spawn lists.
+/// A cache is only used while the size and modification time of the text file still match the ones
+/// it was compiled from. It is read with one read call and copied out in bulk, nothing is parsed.
+/// The numbers are stored in the byte order of the machine, a cache made elsewhere is simply rebuilt.
+/// </summary>
+namespace LevelCache {
+
+    std::string getCachePath(const std::string& mapPath);
+
+    // Fills map and spawns from the cache of mapPath, false when there is no valid cache for it
+    bool load(const std::string& mapPath, TileMap& map, LevelSpawns& spawns);
+
+    // Writes the cache of mapPath, written to a temporary file first so a failed write leaves no broken cache
+    bool save(const std::string& mapPath, const TileMap& map, const LevelSpawns& spawns);
+
+    // Cache when valid, otherwise parses the text map and writes a new cache for next time
+    bool loadOrCompile(const std::string& mapPath, TileMap& map, LevelSpawns& spawns, std::string& error);
+}
@@ -0,0 +1,137 @@
+#include "LevelPrefetcher.hpp"
+#include <algorithm>
+#include <iostream>
+#include <utility>
+#include "LevelBuilder.hpp"
+#include "Trace.hpp"
+
+LevelPrefetcher::~LevelPrefetcher()
+{
+    stop();
+}
+
+void LevelPrefetcher::request(const std::string& mapPath, std::uint32_t seed, float gridCellSize)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (Job* job = find(mapPath, seed)) {
+            job->dropped = false;   // wanted again before it finished
+            return;
+        }
+
+        auto job = std::make_unique<Job>();
+        job->mapPath = mapPath;
+        job->seed = seed;
+        job->gridCellSize = gridCellSize;
+        jobs.push_back(std::move(job));
+
+        // the thread starts with the first request, games that never switch level never make it
+        stopping = false;
+        if (!thread.joinable())
+            thread = std::thread(&LevelPrefetcher::run, this);
+    }
+    wake.notify_one();
+}
+
+bool LevelPrefetcher::take(const std::string& mapPath, std::uint32_t seed, LevelWorld& world)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    Job* job = find(mapPath, seed);
+    if (!job || job->dropped) return false;
+
+    // almost done most likely, waiting beats building it a second time.
+    // A retain meanwhile can drop the job when it finishes, so it is looked up again.
+    finished.wait(lock, [&] {
+        job = find(mapPath, seed);
+        return !job || job->state != State::Building;
+        });
+    if (!job || job->dropped) return false;
+
+    bool ready = job->state == State::Ready;
+    if (ready)
+        std::swap(world, job->world);
+
+    // a queued job is dropped so the caller builds it right away instead of after the others
+    jobs.erase(std::find_if(jobs.begin(), jobs.end(),
+        [job](const std::unique_ptr<Job>& j) { return j.get() == job; }));
+    return ready;
+}
+
+void LevelPrefetcher::retain(const std::vector<std::string>& keep)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    jobs.erase(std::remove_if(jobs.begin(), jobs.end(), [&keep](const std::unique_ptr<Job>& job) {
+        if (std::find(keep.begin(), keep.end(), job->mapPath) != keep.end()) {
+            job->dropped = false;
+            return false;
+        }
+
+        // the thread is still using it, it goes when the build is done
+        if (job->state == State::Building) {
+            job->dropped = true;
+            return false;
+        }
+        return true;
+        }), jobs.end());
+}
+
+void LevelPrefetcher::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    if (thread.joinable())
+        thread.join();
+
+    jobs.clear();
+}
+
+void LevelPrefetcher::run()
+{
+    Trace::setThreadName("level prefetch");
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        Job* job = nullptr;
+        wake.wait(lock, [&] {
+            if (stopping) return true;
+            for (auto& j : jobs) {
+                if (j->state == State::Queued) {
+                    job = j.get();
+                    return true;
+                }
+            }
+            return false;
+            });
+        if (stopping) return;
+
+        // jobs are only erased while not Building, so job stays valid without the lock
+        job->state = State::Building;
+        lock.unlock();
+
+        std::string error;
+        job->world.mapPath = job->mapPath;
+        bool built = LevelBuilder::build(job->world, job->gridCellSize, job->seed, error);
+        if (!built)
+            std::cerr << "Prefetching " << job->mapPath << " failed: " << error << "\n";
+
+        lock.lock();
+        job->state = built ? State::Ready : State::Failed;
+        if (job->dropped) {
+            jobs.erase(std::find_if(jobs.begin(), jobs.end(),
+                [job](const std::unique_ptr<Job>& j) { return j.get() == job; }));
+        }
+        finished.notify_all();
+    }
+}
+
+LevelPrefetcher::Job* LevelPrefetcher::find(const std::string& mapPath, std::uint32_t seed)
+{
+    for (auto& job : jobs) {
+        if (job->mapPath == mapPath && job->seed == seed)
+            return job.get();
+    }
+    return nullptr;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "LevelWorld.hpp"
+
+/// <summary>
+/// Builds levels on a background thread while the current one is played, so switching to them
+/// only moves the finished world in. A level is identified by its map path and spawn seed.
+/// </summary>
+class LevelPrefetcher {
+public:
+    LevelPrefetcher() = default;
+    ~LevelPrefetcher();
+
+    LevelPrefetcher(const LevelPrefetcher&) = delete;
+    LevelPrefetcher& operator=(const LevelPrefetcher&) = delete;
+
+    // Queues the level to be built, nothing happens when it is already queued or built
+    void request(const std::string& mapPath, std::uint32_t seed, float gridCellSize);
+
+    // Moves the prefetched level in to world, waiting when it is being built right now.
+    // False when it was not requested, not started yet or failed to build, the caller builds it then.
+    bool take(const std::string& mapPath, std::uint32_t seed, LevelWorld& world);
+
+    // Forgets every level not in keep, a level being built is dropped once it is done
+    void retain(const std::vector<std::string>& keep);
+
+    // Finishes the level being built and stops the thread, queued levels are dropped
+    void stop();
+
+private:
+    enum class State { Queued, Building, Ready, Failed };
+
+    struct Job {
+        std::string mapPath;
+        std::uint32_t seed = 0;
+        float gridCellSize = 0.f;
+        State state = State::Queued;
+        bool dropped = false;   // retain let go of it while it was being built
+        LevelWorld world;
+    };
+
+    std::mutex mutex;
+    std::condition_variable wake;       // a job was queued or the thread should stop
+    std::condition_variable finished;   // a job left the Building state
+    std::vector<std::unique_ptr<Job>> jobs;
+    bool stopping = false;
+    std::thread thread;
+
+    void run();
+    Job* find(const std::string& mapPath, std::uint32_t seed);
+};
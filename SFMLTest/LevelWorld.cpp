@@ -0,0 +1,40 @@
+#include "LevelWorld.hpp"
+
+void LevelWorld::clear()
+{
+    mapPath.clear();
+    seed = 0;
+    map.clear();
+    spawns.clear();
+    enemies.clear();
+    items.clear();
+    staticLayer.clear();
+    solidTiles.clear();
+    particlePositions.clear();
+    particleRadii.clear();
+    hasPlayerStart = false;
+}
+
+// copy assignment reuses the capacity this world already has, only the items are allocated one by one
+void LevelWorld::copyFrom(const LevelWorld& other)
+{
+    mapPath = other.mapPath;
+    seed = other.seed;
+    map = other.map;
+    spawns = other.spawns;
+    bounds = other.bounds;
+
+    enemies = other.enemies;
+    items.clear();
+    items.reserve(other.items.size());
+    for (const auto& item : other.items)
+        items.push_back(item->clone());
+    staticLayer.copyGeometry(other.staticLayer);
+    solidTiles = other.solidTiles;
+
+    particlePositions = other.particlePositions;
+    particleRadii = other.particleRadii;
+
+    hasPlayerStart = other.hasPlayerStart;
+    playerStart = other.playerStart;
+}
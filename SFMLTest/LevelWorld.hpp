@@ -0,0 +1,43 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Enemy.hpp"
+#include "Item.hpp"
+#include "LevelCache.hpp"
+#include "StaticLayer.hpp"
+#include "TileGrid.hpp"
+#include "TileMap.hpp"
+
+/// <summary>
+/// Everything one level is built in to, kept apart from the running game so it can be built on another thread.
+/// Level::install moves it in to the game when the level starts, the particles are added to the solver then.
+/// </summary>
+struct LevelWorld {
+    std::string mapPath;
+    std::uint32_t seed = 0;   // spawn seed it was built with
+
+    TileMap map;
+    LevelSpawns spawns;
+    sf::RectangleShape bounds;
+
+    std::vector<Enemy> enemies;
+    std::vector<std::unique_ptr<Item>> items;
+    StaticLayer staticLayer;
+    TileGrid solidTiles;
+
+    std::vector<sf::Vector2f> particlePositions;
+    std::vector<float> particleRadii;
+
+    bool hasPlayerStart = false;
+    sf::Vector2f playerStart;
+
+    // Empties everything, the buffers keep their capacity
+    void clear();
+
+    // Makes this an independent copy of other, items are cloned
+    void copyFrom(const LevelWorld& other);
+};
@@ -1,4 +1,6 @@
 #include "MathUtils.hpp"
+#include "TileGrid.hpp"
+#include <cmath>
 // making sure player and enemy wont get out from the map
 sf::Vector2f clampInsideRect(
     const sf::Vector2f& position,
@@ -26,3 +28,46 @@ sf::Vector2f clampInsideRect(
 
     return clamped;
 }
+
+// each overlapping tile pushes the box out along the axis it overlaps least.
+// Tiles are visited row by row and every push moves the box before the next tile is tested
+sf::Vector2f resolveTileCollisions(
+    const sf::Vector2f& position,
+    const sf::Vector2f& size,
+    const TileGrid& tiles
+) {
+    sf::Vector2f resolved = position;
+    sf::Vector2f halfSize = size * 0.5f;
+
+    const float tileSize = tiles.getTileSize();
+    const float tileHalf = tileSize / 2.f;
+    const sf::Vector2f origin = tiles.getOrigin();
+
+    // the tiles under the box and one more on every side, a push can move it on to those
+    sf::Vector2i first = tiles.worldToTile(position - halfSize) - sf::Vector2i(1, 1);
+    sf::Vector2i last = tiles.worldToTile(position + halfSize) + sf::Vector2i(1, 1);
+
+    for (int row = first.y; row <= last.y; ++row) {
+        for (int col = first.x; col <= last.x; ++col) {
+            if (!tiles.isSolid(row, col)) continue;
+
+            sf::Vector2f tilePos(
+                origin.x + col * tileSize + tileSize / 2.f,
+                origin.y + row * tileSize + tileSize / 2.f
+            );
+            sf::Vector2f delta = resolved - tilePos;
+            if (std::abs(delta.x) >= halfSize.x + tileHalf || std::abs(delta.y) >= halfSize.y + tileHalf)
+                continue;
+
+            float overlapX = (halfSize.x + tileHalf) - std::abs(delta.x);
+            float overlapY = (halfSize.y + tileHalf) - std::abs(delta.y);
+
+            if (overlapX < overlapY)
+                resolved.x += delta.x > 0 ? overlapX : -overlapX;
+            else
+                resolved.y += delta.y > 0 ? overlapY : -overlapY;
+        }
+    }
+
+    return resolved;
+}
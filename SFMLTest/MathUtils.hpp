@@ -1,9 +1,18 @@
 #pragma once
 #include <SFML/Graphics.hpp>
 
+class TileGrid;
+
 // Utility function to keep player and enemies inside bounds
 sf::Vector2f clampInsideRect(
     const sf::Vector2f& position,
     const sf::Vector2f& size,
     const sf::RectangleShape& bounds
 );
+
+// Pushes a box out of the solid tiles it overlaps, only the tiles around it are looked at
+sf::Vector2f resolveTileCollisions(
+    const sf::Vector2f& position,
+    const sf::Vector2f& size,
+    const TileGrid& tiles
+);
@@ -0,0 +1,277 @@
+#include "ParticleKernels.hpp"
+#include <cstdint>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define PARTICLE_KERNELS_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit vector instructions inside functions marked for them
+#if defined(__GNUC__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+// the kernels read the x and y of a particle as two neighbouring floats
+static_assert(sizeof(sf::Vector2f) == 2 * sizeof(float), "sf::Vector2f must be two packed floats");
+
+namespace ParticleKernels {
+
+    namespace {
+
+        // one particle, same math as the vector versions so they can be compared
+        inline void integrateOne(float* p, float* l, float* a, float r, const Bounds& bounds,
+            float dt2, float damping, float bounce)
+        {
+            const float lo[2] = { bounds.left + r, bounds.top + r };
+            const float hi[2] = { bounds.right - r, bounds.bottom - r };
+
+            for (int k = 0; k < 2; ++k) {
+                if (p[k] < lo[k]) {
+                    p[k] = lo[k];
+                    l[k] = p[k] + (l[k] - p[k]) * -bounce;
+                }
+                if (p[k] > hi[k]) {
+                    p[k] = hi[k];
+                    l[k] = p[k] + (l[k] - p[k]) * -bounce;
+                }
+
+                float displacement = (p[k] - l[k]) * damping;
+                l[k] = p[k];
+                p[k] = p[k] + displacement + a[k] * dt2;
+                a[k] = 0.f;
+            }
+        }
+
+        void integrateScalar(float* p, float* l, float* a, const float* radii, const unsigned char* sleeping,
+            int begin, int count, const Bounds& bounds, float dt2, float damping, float bounce)
+        {
+            for (int i = begin; i < count; ++i) {
+                if (sleeping && sleeping[i]) continue;
+                integrateOne(p + 2 * i, l + 2 * i, a + 2 * i, radii[i], bounds, dt2, damping, bounce);
+            }
+        }
+
+        enum class BlockState { Awake, Asleep, Mixed };
+
+        // sleeping flags of n neighbouring particles read at once, n is 2 or 4.
+        // Any non zero flag is asleep, frozen particles use a different value than sleeping ones.
+        inline BlockState blockState(const unsigned char* sleeping, int i, int n) {
+            if (!sleeping) return BlockState::Awake;
+
+            std::uint32_t flags = 0;
+            std::memcpy(&flags, sleeping + i, n);
+            if (flags == 0) return BlockState::Awake;
+
+            // sets the high bit of every zero byte
+            std::uint32_t ones = n == 4 ? 0x01010101u : 0x0101u;
+            std::uint32_t highs = n == 4 ? 0x80808080u : 0x8080u;
+            bool anyAwake = ((flags - ones) & ~flags & highs) != 0;
+            return anyAwake ? BlockState::Mixed : BlockState::Asleep;
+        }
+
+#ifdef PARTICLE_KERNELS_X86
+
+        // two particles per register: x0 y0 x1 y1
+        TARGET_SSE2 void integrateSSE(float* p, float* l, float* a, const float* radii, const unsigned char* sleeping,
+            int count, const Bounds& bounds, float dt2, float damping, float bounce)
+        {
+            const __m128 minCorner = _mm_setr_ps(bounds.left, bounds.top, bounds.left, bounds.top);
+            const __m128 maxCorner = _mm_setr_ps(bounds.right, bounds.bottom, bounds.right, bounds.bottom);
+            const __m128 negBounce = _mm_set1_ps(-bounce);
+            const __m128 dampingV = _mm_set1_ps(damping);
+            const __m128 dt2V = _mm_set1_ps(dt2);
+            const __m128 zero = _mm_setzero_ps();
+
+            int i = 0;
+            for (; i + 2 <= count; i += 2) {
+                // whole block asleep is skipped, partly asleep goes one by one
+                BlockState state = blockState(sleeping, i, 2);
+                if (state == BlockState::Asleep) continue;
+                if (state == BlockState::Mixed) {
+                    integrateScalar(p, l, a, radii, sleeping, i, i + 2, bounds, dt2, damping, bounce);
+                    continue;
+                }
+
+                __m128 pos = _mm_loadu_ps(p + 2 * i);
+                __m128 last = _mm_loadu_ps(l + 2 * i);
+                __m128 acc = _mm_loadu_ps(a + 2 * i);
+
+                // r0 r0 r1 r1
+                __m128 r = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(radii + i)));
+                r = _mm_unpacklo_ps(r, r);
+
+                __m128 lo = _mm_add_ps(minCorner, r);
+                __m128 hi = _mm_sub_ps(maxCorner, r);
+
+                __m128 mask = _mm_cmplt_ps(pos, lo);
+                pos = _mm_or_ps(_mm_and_ps(mask, lo), _mm_andnot_ps(mask, pos));
+                __m128 bounced = _mm_add_ps(pos, _mm_mul_ps(_mm_sub_ps(last, pos), negBounce));
+                last = _mm_or_ps(_mm_and_ps(mask, bounced), _mm_andnot_ps(mask, last));
+
+                mask = _mm_cmpgt_ps(pos, hi);
+                pos = _mm_or_ps(_mm_and_ps(mask, hi), _mm_andnot_ps(mask, pos));
+                bounced = _mm_add_ps(pos, _mm_mul_ps(_mm_sub_ps(last, pos), negBounce));
+                last = _mm_or_ps(_mm_and_ps(mask, bounced), _mm_andnot_ps(mask, last));
+
+                __m128 displacement = _mm_mul_ps(_mm_sub_ps(pos, last), dampingV);
+                _mm_storeu_ps(l + 2 * i, pos);
+                pos = _mm_add_ps(_mm_add_ps(pos, displacement), _mm_mul_ps(acc, dt2V));
+                _mm_storeu_ps(p + 2 * i, pos);
+                _mm_storeu_ps(a + 2 * i, zero);
+            }
+
+            integrateScalar(p, l, a, radii, sleeping, i, count, bounds, dt2, damping, bounce);
+        }
+
+        // four particles per register: x0 y0 x1 y1 x2 y2 x3 y3
+        TARGET_AVX2 void integrateAVX2(float* p, float* l, float* a, const float* radii, const unsigned char* sleeping,
+            int count, const Bounds& bounds, float dt2, float damping, float bounce)
+        {
+            const __m256 minCorner = _mm256_setr_ps(bounds.left, bounds.top, bounds.left, bounds.top,
+                bounds.left, bounds.top, bounds.left, bounds.top);
+            const __m256 maxCorner = _mm256_setr_ps(bounds.right, bounds.bottom, bounds.right, bounds.bottom,
+                bounds.right, bounds.bottom, bounds.right, bounds.bottom);
+            const __m256 negBounce = _mm256_set1_ps(-bounce);
+            const __m256 dampingV = _mm256_set1_ps(damping);
+            const __m256 dt2V = _mm256_set1_ps(dt2);
+            const __m256 zero = _mm256_setzero_ps();
+
+            int i = 0;
+            for (; i + 4 <= count; i += 4) {
+                BlockState state = blockState(sleeping, i, 4);
+                if (state == BlockState::Asleep) continue;
+                if (state == BlockState::Mixed) {
+                    integrateScalar(p, l, a, radii, sleeping, i, i + 4, bounds, dt2, damping, bounce);
+                    continue;
+                }
+
+                __m256 pos = _mm256_loadu_ps(p + 2 * i);
+                __m256 last = _mm256_loadu_ps(l + 2 * i);
+                __m256 acc = _mm256_loadu_ps(a + 2 * i);
+
+                // r0 r0 r1 r1 r2 r2 r3 r3
+                __m128 r4 = _mm_loadu_ps(radii + i);
+                __m256 r = _mm256_insertf128_ps(
+                    _mm256_castps128_ps256(_mm_unpacklo_ps(r4, r4)), _mm_unpackhi_ps(r4, r4), 1);
+
+                __m256 lo = _mm256_add_ps(minCorner, r);
+                __m256 hi = _mm256_sub_ps(maxCorner, r);
+
+                __m256 mask = _mm256_cmp_ps(pos, lo, _CMP_LT_OQ);
+                pos = _mm256_blendv_ps(pos, lo, mask);
+                __m256 bounced = _mm256_add_ps(pos, _mm256_mul_ps(_mm256_sub_ps(last, pos), negBounce));
+                last = _mm256_blendv_ps(last, bounced, mask);
+
+                mask = _mm256_cmp_ps(pos, hi, _CMP_GT_OQ);
+                pos = _mm256_blendv_ps(pos, hi, mask);
+                bounced = _mm256_add_ps(pos, _mm256_mul_ps(_mm256_sub_ps(last, pos), negBounce));
+                last = _mm256_blendv_ps(last, bounced, mask);
+
+                __m256 displacement = _mm256_mul_ps(_mm256_sub_ps(pos, last), dampingV);
+                _mm256_storeu_ps(l + 2 * i, pos);
+                pos = _mm256_add_ps(_mm256_add_ps(pos, displacement), _mm256_mul_ps(acc, dt2V));
+                _mm256_storeu_ps(p + 2 * i, pos);
+                _mm256_storeu_ps(a + 2 * i, zero);
+            }
+
+            integrateScalar(p, l, a, radii, sleeping, i, count, bounds, dt2, damping, bounce);
+        }
+
+        bool cpuHasAVX2() {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 0);
+            if (info[0] < 7) return false;
+
+            // the os has to save the ymm registers too
+            __cpuid(info, 1);
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            bool avx = (info[2] & (1 << 28)) != 0;
+            if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) return false;
+
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+        }
+
+        bool cpuHasSSE2() {
+#if defined(_M_X64) || defined(__x86_64__)
+            return true;
+#elif defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+            return (info[3] & (1 << 26)) != 0;
+#else
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse2");
+#endif
+        }
+
+#endif // PARTICLE_KERNELS_X86
+
+        InstructionSet activeSet = detectInstructionSet();
+    }
+
+    InstructionSet detectInstructionSet() {
+#ifdef PARTICLE_KERNELS_X86
+        if (cpuHasAVX2()) return InstructionSet::AVX2;
+        if (cpuHasSSE2()) return InstructionSet::SSE;
+#endif
+        return InstructionSet::Scalar;
+    }
+
+    InstructionSet getInstructionSet() {
+        return activeSet;
+    }
+
+    // never goes above what the cpu supports
+    void setInstructionSet(InstructionSet set) {
+        InstructionSet best = detectInstructionSet();
+        activeSet = static_cast<int>(set) < static_cast<int>(best) ? set : best;
+    }
+
+    const char* getInstructionSetName(InstructionSet set) {
+        switch (set) {
+        case InstructionSet::AVX2: return "AVX2";
+        case InstructionSet::SSE: return "SSE";
+        default: return "Scalar";
+        }
+    }
+
+    void integrate(sf::Vector2f* positions, sf::Vector2f* positionsLast, sf::Vector2f* accelerations,
+        const float* radii, const unsigned char* sleeping, int count, const Bounds& bounds,
+        float dt, float damping, float bounce)
+    {
+        if (count <= 0) return;
+
+        float* p = &positions->x;
+        float* l = &positionsLast->x;
+        float* a = &accelerations->x;
+        float dt2 = dt * dt;
+
+        switch (activeSet) {
+#ifdef PARTICLE_KERNELS_X86
+        case InstructionSet::AVX2:
+            integrateAVX2(p, l, a, radii, sleeping, count, bounds, dt2, damping, bounce);
+            break;
+        case InstructionSet::SSE:
+            integrateSSE(p, l, a, radii, sleeping, count, bounds, dt2, damping, bounce);
+            break;
+#endif
+        default:
+            integrateScalar(p, l, a, radii, sleeping, 0, count, bounds, dt2, damping, bounce);
+            break;
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+
+/// <summary>
+/// Batched particle kernels working on whole arrays at once.
+/// The fastest instruction set of the cpu is picked at runtime, the scalar version works everywhere.
+/// </summary>
+namespace ParticleKernels {
+
+    enum class InstructionSet { Scalar, SSE, AVX2 };
+
+    // Box the particles are kept in, already widened by the border outline
+    struct Bounds {
+        float left;
+        float top;
+        float right;
+        float bottom;
+    };
+
+    // Bounces particles back inside the bounds and then does the verlet step for all of them.
+    // Accelerations are consumed and set to zero. Particles with a non zero sleeping flag are
+    // left untouched, sleeping may be null when nothing sleeps.
+    void integrate(sf::Vector2f* positions, sf::Vector2f* positionsLast, sf::Vector2f* accelerations,
+        const float* radii, const unsigned char* sleeping, int count, const Bounds& bounds,
+        float dt, float damping, float bounce);
+
+    // Best instruction set supported by this cpu
+    InstructionSet detectInstructionSet();
+
+    // Instruction set integrate uses, can be lowered to compare results against the scalar path
+    InstructionSet getInstructionSet();
+    void setInstructionSet(InstructionSet set);
+
+    const char* getInstructionSetName(InstructionSet set);
+}
@@ -0,0 +1,90 @@
+// ParticleRenderer.cpp
+#include "ParticleRenderer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// white disc with a one pixel soft edge, the vertex colour tints it
+void ParticleRenderer::createCircleTexture() {
+    sf::Image image({ textureSize, textureSize }, sf::Color::Transparent);
+
+    float radius = textureSize / 2.f;
+    for (unsigned int y = 0; y < textureSize; ++y) {
+        for (unsigned int x = 0; x < textureSize; ++x) {
+            float dx = x + 0.5f - radius;
+            float dy = y + 0.5f - radius;
+            float coverage = radius - std::sqrt(dx * dx + dy * dy);
+            if (coverage <= 0.f) continue;
+
+            auto alpha = static_cast<std::uint8_t>(std::min(coverage, 1.f) * 255.f);
+            image.setPixel({ x, y }, sf::Color(255, 255, 255, alpha));
+        }
+    }
+
+    if (circleTexture.loadFromImage(image))
+        circleTexture.setSmooth(true);
+    textureReady = true;
+}
+
+void ParticleRenderer::setColor(const sf::Color& newColor) {
+    color = newColor;
+}
+
+void ParticleRenderer::draw(const Solver& solver, sf::RenderTarget& target) {
+    draw(solver.getPositions(), solver.getPreviousPositions(), solver.getRadii(), solver.getInterpolationAlpha(), target);
+}
+
+void ParticleRenderer::draw(const std::vector<sf::Vector2f>& positions, const std::vector<sf::Vector2f>& previous,
+    const std::vector<float>& radii, float alpha, sf::RenderTarget& target)
+{
+    const size_t count = positions.size();
+
+    vertices.resize(count * 6);
+    if (count == 0) return;
+
+    // only particles inside the view are written, the view may show a small part of a large map
+    const sf::View& view = target.getView();
+    sf::Vector2f viewTopLeft = view.getCenter() - view.getSize() / 2.f;
+    sf::Vector2f viewBottomRight = viewTopLeft + view.getSize();
+
+    if (!textureReady)
+        createCircleTexture();
+
+    // a freshly loaded level has no previous positions until its first step
+    bool interpolate = previous.size() == count;
+
+    const float size = static_cast<float>(textureSize);
+    const sf::Vector2f uv[4] = { { 0.f, 0.f }, { size, 0.f }, { size, size }, { 0.f, size } };
+
+    size_t visible = 0;
+    for (size_t i = 0; i < count; ++i) {
+        sf::Vector2f pos = positions[i];
+        if (interpolate)
+            pos = previous[i] + (positions[i] - previous[i]) * alpha;
+
+        // same placement as a CircleShape without origin: pos is the top left of the circle
+        float diameter = radii[i] * 2.f;
+        if (pos.x > viewBottomRight.x || pos.y > viewBottomRight.y ||
+            pos.x + diameter < viewTopLeft.x || pos.y + diameter < viewTopLeft.y)
+            continue;
+
+        const sf::Vector2f corner[4] = {
+            pos,
+            { pos.x + diameter, pos.y },
+            { pos.x + diameter, pos.y + diameter },
+            { pos.x, pos.y + diameter }
+        };
+
+        sf::Vertex* quad = &vertices[visible * 6];
+        const int order[6] = { 0, 1, 2, 0, 2, 3 };
+        for (int k = 0; k < 6; ++k) {
+            quad[k].position = corner[order[k]];
+            quad[k].texCoords = uv[order[k]];
+            quad[k].color = color;
+        }
+        ++visible;
+    }
+
+    if (visible > 0)
+        target.draw(&vertices[0], visible * 6, sf::PrimitiveType::Triangles, sf::RenderStates(&circleTexture));
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include "Solver.hpp"
+
+/// <summary>
+/// Draws all particles of a solver with one draw call.
+/// Every particle is a textured quad (two triangles) sampling a generated circle texture,
+/// the vertex array is rewritten each frame and keeps its memory between frames.
+/// Particles outside the view of the target are left out.
+/// The texture is made on the first draw, so a renderer can exist without a graphics context.
+/// </summary>
+class ParticleRenderer {
+public:
+    // Writes the particles interpolated between the last two physics steps and draws them
+    void draw(const Solver& solver, sf::RenderTarget& target);
+
+    // Same from plain arrays, previous may be empty when there is nothing to blend from
+    void draw(const std::vector<sf::Vector2f>& positions, const std::vector<sf::Vector2f>& previous,
+        const std::vector<float>& radii, float alpha, sf::RenderTarget& target);
+
+    void setColor(const sf::Color& color);
+
+private:
+    sf::Texture circleTexture;
+    sf::VertexArray vertices{ sf::PrimitiveType::Triangles };
+    sf::Color color{ 0, 150, 255, 255 };
+    bool textureReady = false;
+
+    static constexpr unsigned int textureSize = 64;
+
+    void createCircleTexture();
+};
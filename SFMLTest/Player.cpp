@@ -1,6 +1,5 @@
 #include "Player.hpp"
-#include "Wall.hpp"
-#include "MathUtils.hpp"  // for clampInsideRect
+#include "MathUtils.hpp"  // for clampInsideRect and resolveTileCollisions
 #include <iostream>
 #include <cmath>
 
@@ -31,8 +30,24 @@ void Player::handleInput(sf::Keyboard::Key key, bool pressed) {
     }
 }
 
+Player::Input Player::getInput() const {
+    Input input;
+    input.up = up;
+    input.down = down;
+    input.left = left;
+    input.right = right;
+    return input;
+}
+
+void Player::setInput(const Input& input) {
+    up = input.up;
+    down = input.down;
+    left = input.left;
+    right = input.right;
+}
+
 // Update
-void Player::update(const std::vector<Wall>& walls,
+void Player::update(const TileGrid& tiles,
     const sf::RectangleShape& worldBounds)
 {
     velocity = { 0.f, 0.f };
@@ -48,7 +63,7 @@ void Player::update(const std::vector<Wall>& walls,
         clampInsideRect(rect.getPosition(), rect.getSize(), worldBounds)
     );
 
-    resolveCollisions(walls);
+    resolveCollisions(tiles);
 }
 
 // Draw
@@ -56,38 +71,9 @@ void Player::draw(sf::RenderWindow& window) const {
     window.draw(rect);
 }
 
-// checking Collision
-bool Player::checkCollision(const sf::RectangleShape& wallShape) {
-    sf::Vector2f playerPos = rect.getPosition();
-    sf::Vector2f playerHalf = rect.getSize() / 2.f;
-    sf::Vector2f wallPos = wallShape.getPosition();
-    sf::Vector2f wallHalf = wallShape.getSize() / 2.f;
-
-    return (std::abs(playerPos.x - wallPos.x) < (playerHalf.x + wallHalf.x)) &&
-        (std::abs(playerPos.y - wallPos.y) < (playerHalf.y + wallHalf.y));
-}
-//resolving collision
-void Player::resolveCollisions(const std::vector<Wall>& walls) {
-    sf::Vector2f playerPos = rect.getPosition();
-    sf::Vector2f playerHalf = rect.getSize() / 2.f;
-
-    for (const auto& wall : walls) {
-        sf::Vector2f wallPos = wall.shape.getPosition();
-        sf::Vector2f wallHalf = wall.shape.getSize() / 2.f;
-
-        if (checkCollision(wall.shape)) {
-            sf::Vector2f delta = playerPos - wallPos;
-            float overlapX = (playerHalf.x + wallHalf.x) - std::abs(delta.x);
-            float overlapY = (playerHalf.y + wallHalf.y) - std::abs(delta.y);
-
-            if (overlapX < overlapY)
-                playerPos.x += delta.x > 0 ? overlapX : -overlapX;
-            else
-                playerPos.y += delta.y > 0 ? overlapY : -overlapY;
-
-            rect.setPosition(playerPos);
-        }
-    }
+//resolving collision against the solid tiles around the player
+void Player::resolveCollisions(const TileGrid& tiles) {
+    rect.setPosition(resolveTileCollisions(rect.getPosition(), rect.getSize(), tiles));
 }
 
 // Position getter
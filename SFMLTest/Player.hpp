@@ -6,15 +6,20 @@
 #include <functional>
 
 
-// Forward declaration
-class Wall;
-
 class Player : public Entity {
 public:
     float oxygenTime = 30.f;
     int deaths = 0;
     int totalTreasuresCollected = 0;
 
+    // Movement keys held down
+    struct Input {
+        bool up = false;
+        bool down = false;
+        bool left = false;
+        bool right = false;
+    };
+
     // Constructor
     Player(float sizeX = 20.f, float sizeY = 20.f);
 
@@ -24,9 +29,11 @@ public:
 
     // Input handling
     void handleInput(sf::Keyboard::Key key, bool pressed);
+    Input getInput() const;
+    void setInput(const Input& input);
 
     // Update and drawing
-    void update(const std::vector<Wall>& walls, const sf::RectangleShape& worldBounds) override;
+    void update(const TileGrid& tiles, const sf::RectangleShape& worldBounds) override;
     void draw(sf::RenderWindow& window) const;
 
     // Collision and state
@@ -37,8 +44,7 @@ public:
     void reset();
 
 private:
-    void resolveCollisions(const std::vector<Wall>& walls);
-    bool checkCollision(const sf::RectangleShape& wallShape);
+    void resolveCollisions(const TileGrid& tiles);
 
     sf::RectangleShape rect;
     sf::Vector2f velocity;
@@ -19,19 +19,25 @@
 #include <optional>
 #include <sstream>
 #include "Player.hpp"
-#include "Wall.hpp"
 #include "Entity.hpp"
 #include "MathUtils.hpp"
 #include "Enemy.hpp"
-#include "Particle.hpp"
 #include "Solver.hpp"
 #include "Item.hpp"
 #include "Items.hpp"
 #include <memory>
+#include <thread>
 #include "Level.hpp"
 #include "LevelBuilder.hpp"
 #include "HallOfFame.hpp"
 #include "GameData.hpp"
+#include "InputRecording.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
 
 
 
@@ -53,10 +59,50 @@ enum class InputAction {
 
 
 
+/****************************************************************
+ *
+ * ENUM FrameOutcome
+ *
+ * What happened during one update_game frame.
+ *
+ **************************************************************/
+enum class FrameOutcome {
+	Running,
+	LevelComplete
+};
+
+/****************************************************************
+ *
+ * STRUCT CommandLine
+ *
+ * Options given to the program, the game is played normally without any.
+ *   --record <file> [--seed N] [--level N | --map <file>]
+ *   --replay <file>
+ *   --trace <file>   writes a Chrome trace of the whole run
+ *   --async-physics  steps the particles on their own thread (not while recording)
+ *
+ **************************************************************/
+struct CommandLine {
+	std::string recordPath;
+	std::string replayPath;
+	std::string tracePath;
+	bool asyncPhysics = false;
+	std::uint32_t seed = 0;
+	bool seedGiven = false;
+	int mapIndex = 0;
+	std::string customMap;
+};
+
 // ------------------- Function declarations -------------------
 InputAction read_input(char* input, Level& currentLevel, GameData& gameData);
 void handleAbortMission(Level& currentLevel, Enemy& enemy, GameData& gameData);
-void render_screen( Level& currentLevel, Enemy& enemy, GameData& gameData);
+void render_screen(Level& currentLevel, Enemy& enemy, GameData& gameData, InputRecorder* recorder = nullptr, float fixedDt = 1.f / 60.f);
+FrameOutcome update_game(Level& currentLevel, GameData& gameData, const FrameInput& input, float dt);
+void draw_game(Level& currentLevel, GameData& gameData, sf::RenderWindow& window);
+void complete_level(Level& currentLevel, Enemy& enemy, GameData& gameData);
+bool parse_command_line(int argc, char** argv, CommandLine& options);
+int run_recording(const CommandLine& options, Level& currentLevel, Enemy& enemy, GameData& gameData);
+int run_replay(const CommandLine& options, Level& currentLevel, Enemy& enemy, GameData& gameData);
 void start_splash_screen(Level& currentLevel, GameData& gameData);
 void quit_routines(Level& currentLevel, GameData& gameData);
 
@@ -64,12 +110,27 @@ void quit_routines(Level& currentLevel, GameData& gameData);
 // ------------------- Main -------------------
 char input;
 
-int main(void)
+int main(int argc, char** argv)
 {
-	GameData gameData; // contains player, particleSolver, walls, isRendering
+	GameData gameData; // contains player, particleSolver, solidTiles, isRendering
 	Level currentLevel;
 	Enemy enemy({ 200.f, 200.f }, 0);
 
+	// Solve particle collisions on every core
+	gameData.particleSolver.setThreadCount(static_cast<int>(std::thread::hardware_concurrency()));
+
+	// Recording and replay skip the menus
+	CommandLine options;
+	if (!parse_command_line(argc, argv, options))
+		return 1;
+	if (!options.tracePath.empty())
+		Trace::start(options.tracePath);
+	gameData.asyncPhysics = options.asyncPhysics;
+	if (!options.replayPath.empty())
+		return run_replay(options, currentLevel, enemy, gameData);
+	if (!options.recordPath.empty())
+		return run_recording(options, currentLevel, enemy, gameData);
+
 	// Show splash screen and instructions
 	start_splash_screen(currentLevel, gameData);
 
@@ -116,6 +177,39 @@ int main(void)
 }
 
 
+/****************************************************************
+ *
+ * FUNCTION parse_command_line
+ *
+ * Fills CommandLine from the program arguments.
+ * Returns false and prints the usage on anything it does not know.
+ *
+ **************************************************************/
+bool parse_command_line(int argc, char** argv, CommandLine& options)
+{
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+
+		if (arg == "--record" && hasValue) options.recordPath = argv[++i];
+		else if (arg == "--replay" && hasValue) options.replayPath = argv[++i];
+		else if (arg == "--trace" && hasValue) options.tracePath = argv[++i];
+		else if (arg == "--async-physics") options.asyncPhysics = true;
+		else if (arg == "--seed" && hasValue) {
+			options.seed = static_cast<std::uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			options.seedGiven = true;
+		}
+		else if (arg == "--level" && hasValue) options.mapIndex = std::atoi(argv[++i]) - 1;
+		else if (arg == "--map" && hasValue) options.customMap = argv[++i];
+		else {
+			std::cerr << "Unknown option: " << arg << "\n";
+			std::cerr << "Usage: " << argv[0] << " [--record <file> [--seed N] [--level N | --map <file>]] [--replay <file>] [--trace <file>] [--async-physics]\n";
+			return false;
+		}
+	}
+	return true;
+}
+
 /****************************************************************
  *
  * FUNCTION read_input
@@ -241,18 +335,280 @@ void handleAbortMission(Level& currentLevel, Enemy& enemy, GameData& gameData)
 
 
 
+/****************************************************************
+ *
+ * FUNCTION update_game
+ *
+ * Advances the game by one frame from the given input.
+ * - Moves the mouse force emitter
+ * - Manages oxygen depletion
+ * - Updates particles, enemies and the player
+ * - Moves the camera and the resident chunks after the player
+ * - Handles item pickups and reports mission completion
+ * Reads nothing but its arguments, so recorded input replays identically.
+ *
+ **************************************************************/
+FrameOutcome update_game(Level& currentLevel, GameData& gameData, const FrameInput& input, float dt)
+{
+	TRACE_ZONE("update_game");
+	gameData.player.setInput(input.keys);
+
+	// With the physics thread running the solver is only reached through its command queue
+	SolverThread& solverThread = gameData.solverThread;
+	bool asyncPhysics = solverThread.isRunning();
+
+	/********************
+	 * MOUSE PUSH
+	 ********************/
+	// While the button is held an emitter under the cursor pushes the nearby particles away
+	if (input.mouseDown) {
+		if (asyncPhysics) {
+			gameData.mouseEmitter = 0;
+			solverThread.setEmitter(gameData.mouseEmitter, input.mouse, 200.f, 7200.f);
+		}
+		else if (gameData.mouseEmitter < 0)
+			gameData.mouseEmitter = gameData.particleSolver.addForceEmitter(input.mouse, 200.f, 7200.f);
+		else
+			gameData.particleSolver.setForceEmitterPosition(gameData.mouseEmitter, input.mouse);
+	}
+	else if (gameData.mouseEmitter >= 0) {
+		if (asyncPhysics)
+			solverThread.removeEmitter(gameData.mouseEmitter);
+		else
+			gameData.particleSolver.removeForceEmitter(gameData.mouseEmitter);
+		gameData.mouseEmitter = -1;
+	}
+
+	FrameProfiler& profiler = gameData.profiler;
+
+	/********************
+	 * OXYGEN HANDLING
+	 ********************/
+	{
+		FrameProfiler::Scope scope(profiler, FrameProfiler::Phase::Oxygen);
+
+		gameData.oxygenTimer += dt;
+		if (gameData.oxygenTimer >= 1.0f) {
+			gameData.player.oxygenTime -= 1.0f;
+
+			// Clamp oxygen to zero and apply damage
+			if (gameData.player.oxygenTime < 0.f) {
+				gameData.player.oxygenTime = 0.f;
+				gameData.player.takeDamage(2);
+			}
+
+			gameData.oxygenTimer = 0.f;
+		}
+	}
+
+	/********************
+	 * UPDATE
+	 ********************/
+	{
+		FrameProfiler::Scope scope(profiler, FrameProfiler::Phase::Particles);
+		if (!asyncPhysics)
+			gameData.particleSolver.update(currentLevel.bounds, dt);
+	}
+
+	// Update enemies
+	{
+		FrameProfiler::Scope scope(profiler, FrameProfiler::Phase::Enemies);
+		for (auto& e : currentLevel.enemies) {
+			e.update(gameData.solidTiles, currentLevel.bounds);  // movement + collisions
+			e.updateAI(dt, gameData.player);          // chasing, oscillation, damage
+		}
+	}
+
+	// Update player physics and collisions
+	{
+		FrameProfiler::Scope scope(profiler, FrameProfiler::Phase::Player);
+		gameData.player.update(gameData.solidTiles, currentLevel.bounds);
+	}
+
+	/********************
+	 * CAMERA & STREAMING
+	 ********************/
+	// Chunks within one chunk of the view are resident, the solver only keeps the particles around them.
+	// Particles in view run every step, the ones off screen less often.
+	// The areas take effect from the next physics step.
+	{
+		FrameProfiler::Scope scope(profiler, FrameProfiler::Phase::Streaming);
+		gameData.camera.follow(gameData.player.getPosition(), currentLevel.bounds);
+
+		sf::FloatRect area = gameData.camera.getArea(StaticLayer::chunkTiles * gameData.solidTiles.getTileSize());
+		sf::FloatRect visible = gameData.camera.getVisibleArea();
+		gameData.staticLayer.updateResidency(area, gameData.solidTiles);
+		if (asyncPhysics) {
+			solverThread.setActiveArea(area);
+			solverThread.setFocusArea(visible);
+		}
+		else {
+			gameData.particleSolver.setActiveArea(area);
+			gameData.particleSolver.setFocusArea(visible);
+		}
+	}
+
+	/********************
+	 * ITEM PICKUPS
+	 ********************/
+	{
+		FrameProfiler::Scope scope(profiler, FrameProfiler::Phase::Pickups);
+		for (auto& item : currentLevel.items) {
+			if (!item->collected) {
+				sf::Vector2f diff = item->position - gameData.player.getPosition();
+				float distance = std::sqrt(diff.x * diff.x + diff.y * diff.y);
+				float pickupRadius = 15.f;
+
+				if (distance < pickupRadius) {
+					item->applyEffect(gameData.player);
+					item->collected = true;
+				}
+			}
+		}
+	}
+
+	/********************
+	 * LEVEL COMPLETION
+	 ********************/
+	FrameProfiler::Scope scope(profiler, FrameProfiler::Phase::Completion);
+	if (currentLevel.getCollectedTreasures() == currentLevel.items.size() &&
+		!currentLevel.items.empty())
+		return FrameOutcome::LevelComplete;
+
+	return FrameOutcome::Running;
+}
+
+/****************************************************************
+ *
+ * FUNCTION draw_game
+ *
+ * Renders all visual elements of the current frame.
+ *
+ **************************************************************/
+void draw_game(Level& currentLevel, GameData& gameData, sf::RenderWindow& window)
+{
+	TRACE_ZONE("draw_game");
+	FrameProfiler& profiler = gameData.profiler;
+
+	{
+		FrameProfiler::Scope scope(profiler, FrameProfiler::Phase::DrawWorld);
+
+		window.clear(sf::Color(20, 20, 40));
+
+		// The world is drawn through the camera, only what it shows is drawn
+		window.setView(gameData.camera.getView());
+		sf::FloatRect visible = gameData.camera.getVisibleArea();
+
+		// Draw map border
+		window.draw(currentLevel.bounds);
+
+		// Draw walls, baked per chunk
+		gameData.staticLayer.drawWalls(window);
+
+		// Draw items
+		for (auto& item : currentLevel.items) {
+			if (!item->collected && visible.findIntersection(item->shape.getGlobalBounds()))
+				window.draw(item->shape);
+		}
+
+		// Draw enemies
+		for (auto& e : currentLevel.enemies)
+			e.draw(window);
+	}
+
+	// Draw particles
+	{
+		FrameProfiler::Scope scope(profiler, FrameProfiler::Phase::DrawParticles);
+
+		// the physics thread hands over its newest finished step
+		if (gameData.solverThread.isRunning()) {
+			const SolverThread::Snapshot& snapshot = gameData.solverThread.acquireLatest();
+			gameData.particleRenderer.draw(snapshot.positions, snapshot.previous, snapshot.radii,
+				gameData.solverThread.getInterpolationAlpha(snapshot), window);
+		}
+		else
+			gameData.particleRenderer.draw(gameData.particleSolver, window);
+	}
+
+	{
+		FrameProfiler::Scope scope(profiler, FrameProfiler::Phase::DrawGrid);
+		gameData.staticLayer.drawGrid(window);
+	}
+
+	{
+		FrameProfiler::Scope scope(profiler, FrameProfiler::Phase::Display);
+
+		// Draw player last (on top)
+		gameData.player.draw(window);
+
+		// Profiler overlay above everything in window coordinates, F3 switches it
+		window.setView(window.getDefaultView());
+		profiler.drawOverlay(window);
+
+		window.display();
+	}
+}
+
+/****************************************************************
+ *
+ * FUNCTION complete_level
+ *
+ * Called when every mineral of the level is collected.
+ * Moves on to the next map, or records the Hall of Fame entry after the last one.
+ *
+ **************************************************************/
+void complete_level(Level& currentLevel, Enemy& enemy, GameData& gameData)
+{
+	int collectedCount = currentLevel.getCollectedTreasures();
+
+	bool lastLevel =
+		(currentLevel.currentMapIndex ==
+			currentLevel.mapFiles.size() - 1);
+
+	gameData.isRendering = false;
+
+	if (lastLevel) {
+		std::string playerName;
+		std::cout << "Congratulations! Thanks to you our company's shareholders' profits have tripled during the time of your diving. Enter your name for the company's Hall of Fame record: ";
+		std::cin >> playerName;
+
+		currentLevel.addCollectedToTotal(gameData.player) += collectedCount;
+		int totalTreasures = currentLevel.addCollectedToTotal(gameData.player);
+		int deathCount = gameData.player.deaths;
+
+		HallOfFame hof;
+		hof.load();
+		hof.addEntry({
+			playerName,
+			currentLevel.currentMapIndex + 1,
+			totalTreasures,
+			deathCount
+			});
+		hof.display();
+
+		currentLevel.load(gameData, enemy);
+	}
+	else {
+		currentLevel.customMapFile = false;
+		std::cout << "All minerals collected! Thanks to you our company's profits are rising! Ready for next mission?\n";
+		currentLevel.addCollectedToTotal(gameData.player) += collectedCount;
+		currentLevel.currentMapIndex++;
+		currentLevel.load(gameData, enemy);
+	}
+}
+
 /****************************************************************
  *
  * FUNCTION render_screen
  *
  * Handles the main SFML rendering loop.
- * - Processes user input (keyboard & mouse)
- * - Updates game state (player, enemies, particles)
- * - Renders all visual elements
- * - Manages oxygen depletion and mission completion
+ * - Processes user input (keyboard & mouse) in to a FrameInput
+ * - Updates the game with update_game and renders it with draw_game
+ * - Writes every frame's input to the recorder when one is given,
+ *   frames then advance by the recording's fixed dt
  *
  **************************************************************/
-void render_screen(Level& currentLevel, Enemy& enemy, GameData& gameData)
+void render_screen(Level& currentLevel, Enemy& enemy, GameData& gameData, InputRecorder* recorder, float fixedDt)
 {
 	
 
@@ -272,72 +628,86 @@ void render_screen(Level& currentLevel, Enemy& enemy, GameData& gameData)
 		window.close();
 		};
 
-	while (window.isOpen()) {
-		std::optional<sf::Event> eventOpt;
+	// Particles step on their own thread while this window is open, recordings stay on this one
+	// so they replay the same
+	if (gameData.asyncPhysics && !recorder)
+		gameData.solverThread.start(currentLevel.bounds);
 
-		// Clock for frame delta time
-		static sf::Clock deltaClock;
+	// Clock for frame delta time
+	sf::Clock deltaClock;
 
-		// Clock for oxygen depletion (1 second ticks)
-		static sf::Clock oxygenClock;
+	while (window.isOpen()) {
+		std::optional<sf::Event> eventOpt;
 
 		float dt = deltaClock.restart().asSeconds();
+		if (recorder)
+			dt = fixedDt;
+
+		gameData.profiler.beginFrame();
 
 		/********************
 		 * EVENT PROCESSING
 		 ********************/
-		while ((eventOpt = window.pollEvent())) {
-			sf::Event event = *eventOpt;
-
-			// Window close event
-			if (event.is<sf::Event::Closed>()) {
-				window.close();
-				gameData.isRendering = false;
-				return; // return control to main()
-			}
+		FrameInput input;
+		{
+			FrameProfiler::Scope scope(gameData.profiler, FrameProfiler::Phase::Events);
+
+			while ((eventOpt = window.pollEvent())) {
+				sf::Event event = *eventOpt;
+
+				// Window close event
+				if (event.is<sf::Event::Closed>()) {
+					window.close();
+					gameData.isRendering = false;
+					break; // leaves the loop and returns control to main()
+				}
 
-			// Mouse input: push particles away from cursor
-			if (sf::Mouse::isButtonPressed(sf::Mouse::Button(0))) {
-				sf::Vector2i mousePos = sf::Mouse::getPosition(window);
-				sf::Vector2f mousePosF(
-					static_cast<float>(mousePos.x),
-					static_cast<float>(mousePos.y)
-				);
-
-				for (auto& p : gameData.particleSolver.getObjects()) {
-					sf::Vector2f dir = p.position - mousePosF;
-					float length = std::sqrt(dir.x * dir.x + dir.y * dir.y);
-					if (length != 0) dir /= length;
-
-					float strength = 20.0f;
-					p.addVelocity(dir * strength, 1.0f / 60.0f);
+				// Key pressed
+				if (auto* keyEvent = event.getIf<sf::Event::KeyPressed>()) {
+					gameData.player.handleInput(keyEvent->code, true);
+
+					// G switches the debug grid overlay, F3 the profiler overlay
+					if (keyEvent->code == sf::Keyboard::Key::G)
+						gameData.staticLayer.toggleGrid();
+					if (keyEvent->code == sf::Keyboard::Key::F3)
+						gameData.profiler.toggleOverlay();
 				}
-			}
 
-			// Key pressed
-			if (auto* keyEvent = event.getIf<sf::Event::KeyPressed>()) {
-				gameData.player.handleInput(keyEvent->code, true);
+				// Key released
+				if (auto* keyEvent = event.getIf<sf::Event::KeyReleased>()) {
+					gameData.player.handleInput(keyEvent->code, false);
+				}
 			}
 
-			// Key released
-			if (auto* keyEvent = event.getIf<sf::Event::KeyReleased>()) {
-				gameData.player.handleInput(keyEvent->code, false);
+			// The mouse is read every frame, not only when an event happens to be queued
+			input.keys = gameData.player.getInput();
+			input.mouseDown = window.hasFocus() && sf::Mouse::isButtonPressed(sf::Mouse::Button::Left);
+			if (input.mouseDown) {
+				sf::Vector2i mousePos = sf::Mouse::getPosition(window);
+				input.mouse = window.mapPixelToCoords(mousePos, gameData.camera.getView());
 			}
 		}
 
-		/********************
-		 * OXYGEN HANDLING
-		 ********************/
-		if (oxygenClock.getElapsedTime().asSeconds() >= 1.0f) {
-			gameData.player.oxygenTime -= 1.0f;
+		// Window was closed
+		if (!window.isOpen())
+			break;
 
-			// Clamp oxygen to zero and apply damage
-			if (gameData.player.oxygenTime < 0.f) {
-				gameData.player.oxygenTime = 0.f;
-				gameData.player.takeDamage(2);
-			}
+		if (recorder)
+			recorder->record(input);
+
+		FrameOutcome outcome = update_game(currentLevel, gameData, input, dt);
+
+		// Window closed or player died during the update
+		if (!window.isOpen())
+			break;
 
-			oxygenClock.restart();
+		if (outcome == FrameOutcome::LevelComplete) {
+			window.close();
+
+			// the next level is loaded in to the solver
+			gameData.solverThread.stop();
+			complete_level(currentLevel, enemy, gameData);
+			break;
 		}
 
 		// Update window title with player status
@@ -347,115 +717,134 @@ void render_screen(Level& currentLevel, Enemy& enemy, GameData& gameData)
 			std::to_string((int)gameData.player.health) + " hp"
 		);
 
-		/********************
-		 * UPDATE & RENDER
-		 ********************/
-		gameData.particleSolver.update(currentLevel.bounds);
-
-
-		window.clear(sf::Color(20, 20, 40));
-
-		// Draw map border
-		window.draw(currentLevel.bounds);
-
-		// Draw walls
-		for (auto& wall : gameData.walls) {
-			wall.draw(window);
-		}
-
-		// Draw items
-		for (auto& item : currentLevel.items) {
-			if (!item->collected)
-				window.draw(item->shape);
-		}
-
-		// Update and draw enemies
-		for (auto& e : currentLevel.enemies) {
-			e.update(gameData.walls, currentLevel.bounds);  // movement + collisions
-			e.updateAI(dt, gameData.player);          // chasing, oscillation, damage
-			e.draw(window);                 // render
-		}
-
+		draw_game(currentLevel, gameData, window);
+		gameData.profiler.endFrame();
+	}
 
-		// Draw particles
-		for (Particle& p : gameData.particleSolver.getObjects())
-			window.draw(p.shape);
+	gameData.solverThread.stop();
+}
 
-		gameData.particleSolver.drawGrid(currentLevel.bounds, window);
+/****************************************************************
+ *
+ * FUNCTION run_recording
+ *
+ * Plays one level in a window like the normal game while recording
+ * the seed and every frame's input to a file. Frames use a fixed dt.
+ *
+ **************************************************************/
+int run_recording(const CommandLine& options, Level& currentLevel, Enemy& enemy, GameData& gameData)
+{
+	RecordingHeader header;
+	header.seed = options.seedGiven ? options.seed : static_cast<std::uint32_t>(std::time(nullptr));
+	header.mapIndex = options.mapIndex;
+	header.customMap = options.customMap;
+
+	InputRecorder recorder;
+	if (!recorder.open(options.recordPath, header))
+		return 1;
+
+	// the seed goes first so the level spawns the same way on replay
+	currentLevel.spawnSeed = header.seed;
+	currentLevel.customMapFile = !header.customMap.empty();
+	currentLevel.customMapFileName = header.customMap;
+	currentLevel.currentMapIndex = header.mapIndex;
+	currentLevel.load(gameData, enemy);
 
-		// Update player physics and collisions
-		gameData.player.update(gameData.walls, currentLevel.bounds);
+	gameData.isRendering = true;
+	render_screen(currentLevel, enemy, gameData, &recorder, header.dt);
 
-		/********************
-		 * ITEM PICKUPS
-		 ********************/
-		for (auto& item : currentLevel.items) {
-			if (!item->collected) {
-				sf::Vector2f diff = item->position - gameData.player.getPosition();
-				float distance = std::sqrt(diff.x * diff.x + diff.y * diff.y);
-				float pickupRadius = 15.f;
+	std::cout << "Recorded " << recorder.getFrameCount() << " frames with seed " << header.seed
+		<< " to " << options.recordPath << "\n";
+	recorder.close();
+	quit_routines(currentLevel, gameData);
+	return 0;
+}
 
-				if (distance < pickupRadius) {
-					item->applyEffect(gameData.player);
-					item->collected = true;
-				}
-			}
-		}
+/****************************************************************
+ *
+ * FUNCTION run_replay
+ *
+ * Drives update_game from a recording without opening a window,
+ * as fast as the machine can go. Prints the frame cost and a
+ * checksum of the final state so two runs can be compared.
+ *
+ **************************************************************/
+int run_replay(const CommandLine& options, Level& currentLevel, Enemy& enemy, GameData& gameData)
+{
+	InputReplay replay;
+	if (!replay.load(options.replayPath))
+		return 1;
+
+	const RecordingHeader& header = replay.getHeader();
+	currentLevel.spawnSeed = header.seed;
+	currentLevel.prefetchEnabled = false;   // only one level is played, building others would skew the timings
+	currentLevel.customMapFile = !header.customMap.empty();
+	currentLevel.customMapFileName = header.customMap;
+	currentLevel.currentMapIndex = header.mapIndex;
+	currentLevel.load(gameData, enemy);
+	if (currentLevel.map.empty())
+		return 1;
+
+	bool died = false;
+	gameData.player.onDeath = [&]() { died = true; };
+
+	using Clock = std::chrono::steady_clock;
+	double totalMs = 0.0;
+	double worstMs = 0.0;
+	int frames = 0;
+	FrameOutcome outcome = FrameOutcome::Running;
+
+	for (const FrameInput& input : replay.getFrames()) {
+		auto start = Clock::now();
+		gameData.profiler.beginFrame();
+		outcome = update_game(currentLevel, gameData, input, header.dt);
+		gameData.profiler.endFrame();
+		double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		totalMs += ms;
+		worstMs = std::max(worstMs, ms);
+		++frames;
+
+		if (died || outcome == FrameOutcome::LevelComplete)
+			break;
+	}
 
-		/********************
-		 * LEVEL COMPLETION
-		 ********************/
-		int collectedCount = currentLevel.getCollectedTreasures();
-		int totalCount = currentLevel.getTotalTreasures();
-
-		if (collectedCount == currentLevel.items.size() &&
-			!currentLevel.items.empty()) {
-
-			bool lastLevel =
-				(currentLevel.currentMapIndex ==
-					currentLevel.mapFiles.size() - 1);
-
-			if (lastLevel) {
-				gameData.isRendering = false;
-				window.close();
-
-				std::string playerName;
-				std::cout << "Congratulations! Thanks to you our company's shareholders' profits have tripled during the time of your diving. Enter your name for the company's Hall of Fame record: ";
-				std::cin >> playerName;
-
-				currentLevel.addCollectedToTotal(gameData.player) += collectedCount;
-				int totalTreasures = currentLevel.addCollectedToTotal(gameData.player);
-				int deathCount = gameData.player.deaths;
-
-				HallOfFame hof;
-				hof.load();
-				hof.addEntry({
-					playerName,
-					currentLevel.currentMapIndex + 1,
-					totalTreasures,
-					deathCount
-					});
-				hof.display();
-
-				currentLevel.load(gameData, enemy);
-			}
-			else {
-				currentLevel.customMapFile = false;
-				std::cout << "All minerals collected! Thanks to you our company's profits are rising! Ready for next mission?\n";
-				currentLevel.addCollectedToTotal(gameData.player) += collectedCount;
-				currentLevel.currentMapIndex++;
-				gameData.isRendering = false;
-				window.close();
-				currentLevel.load(gameData, enemy);
-			}
+	// FNV-1a over the final particle and player positions, paged out particles are brought back first
+	gameData.particleSolver.clearActiveArea();
+	std::uint64_t checksum = 1469598103934665603ull;
+	auto mix = [&checksum](const void* data, size_t size) {
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; ++i) {
+			checksum ^= bytes[i];
+			checksum *= 1099511628211ull;
 		}
-
-		// Draw player last (on top)
-		gameData.player.draw(window);
-
-		window.display();
+		};
+	const auto& positions = gameData.particleSolver.getPositions();
+	if (!positions.empty())
+		mix(positions.data(), positions.size() * sizeof(sf::Vector2f));
+	sf::Vector2f playerPos = gameData.player.getPosition();
+	mix(&playerPos, sizeof(playerPos));
+
+	std::cout << "Replayed " << frames << " of " << replay.getFrames().size() << " frames"
+		<< (died ? " (player died)" : outcome == FrameOutcome::LevelComplete ? " (level complete)" : "") << "\n";
+	std::cout << "Simulated " << frames * header.dt << " s in " << totalMs / 1000.0 << " s, "
+		<< (totalMs > 0.0 ? frames * 1000.0 / totalMs : 0.0) << " frames/s\n";
+	std::cout << "Frame cost: average " << (frames > 0 ? totalMs / frames : 0.0) << " ms, worst " << worstMs << " ms\n";
+	std::cout << "State checksum: " << std::hex << checksum << std::dec << "\n";
+
+	FrameProfiler::Summary summary = gameData.profiler.summarize();
+	std::cout << "Last " << summary.frames << " frames: p50 " << summary.frameP50 << " ms, p95 " << summary.frameP95
+		<< " ms, p99 " << summary.frameP99 << " ms\n";
+	for (int p = 0; p < FrameProfiler::PhaseCount; ++p) {
+		if (summary.phaseAverage[p] > 0.f)
+			std::cout << "  " << FrameProfiler::getPhaseName(static_cast<FrameProfiler::Phase>(p))
+				<< ": " << summary.phaseAverage[p] << " ms\n";
 	}
+
+	quit_routines(currentLevel, gameData);
+	return 0;
 }
+
 /****************************************************************
  *
  * FUNCTION start_splash_screen
@@ -534,11 +923,11 @@ void quit_routines(Level& currentLevel, GameData& gameData)
 	// Clear enemies
 	currentLevel.enemies.clear();
 
-	// Clear walls vector (global)
-	gameData.walls.clear();
+	// Clear the walls (global)
+	gameData.staticLayer.clear();
 
 	// Clear particle solver objects
-	gameData.particleSolver.getObjects().clear();
+	gameData.particleSolver.clear();
 
 	// Reset map indices
 	currentLevel.currentMapIndex = 0;
@@ -546,6 +935,13 @@ void quit_routines(Level& currentLevel, GameData& gameData)
 	// Reset player (optional)
 	gameData.player.reset();
 
+	// Write the trace if one is being captured
+	Trace::stop();
+
+	// Keep the timings of the last frames for later digging
+	if (gameData.profiler.writeCsv("frame_profile.csv"))
+		std::cout << "Frame timings written to frame_profile.csv\n";
+
 	std::cout << "\nBYE! Welcome back soon.\n";
 }
 
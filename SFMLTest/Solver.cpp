@@ -1,129 +1,1227 @@
 // Solver.cpp
 #include "Solver.hpp"
+#include "ParticleKernels.hpp"
+#include "Trace.hpp"
+#include <algorithm>
 #include <cmath>
 
-//SpatialHashGrid dividing the particles in to smaller areas to check collisions
-Solver::SpatialHashGrid::SpatialHashGrid(float cellSize_) : cellSize(cellSize_) {}
+// UniformGrid dividing the map area in to equal cells so only nearby particles are compared
+Solver::UniformGrid::UniformGrid(float cellSize_) : cellSize(cellSize_) {}
 
-long long Solver::SpatialHashGrid::hash(int x, int y) const {
-    return ((long long)x << 32) ^ (long long)y;
+// sizes the grid to cover the map, the arrays only grow when the map gets bigger
+void Solver::UniformGrid::resize(const sf::Vector2f& topLeft, const sf::Vector2f& size) {
+    int newCols = std::max(1, static_cast<int>(std::ceil(size.x / cellSize)));
+    int newRows = std::max(1, static_cast<int>(std::ceil(size.y / cellSize)));
+    if (topLeft == origin && newCols == cols && newRows == rows) return;
+
+    origin = topLeft;
+    cols = newCols;
+    rows = newRows;
+    cellStart.resize(static_cast<size_t>(cols) * rows + 1);
+    needsRebuild = true;
 }
 
-sf::Vector2i Solver::SpatialHashGrid::worldToCell(const sf::Vector2f& pos, const sf::Vector2f& rectTopLeft) const {
-    sf::Vector2f relativePos = pos - rectTopLeft;
+sf::Vector2i Solver::UniformGrid::worldToCell(const sf::Vector2f& pos) const {
+    sf::Vector2f relativePos = pos - origin;
     return sf::Vector2i((int)std::floor(relativePos.x / cellSize), (int)std::floor(relativePos.y / cellSize));
 }
 
-void Solver::SpatialHashGrid::insert(const sf::Vector2f& pos, int index, const sf::Vector2f& rectTopLeft) {
-    sf::Vector2i cell = worldToCell(pos, rectTopLeft);
-    long long key = hash(cell.x, cell.y);
-    grid[key].push_back(index);
+// particles slightly outside the map are kept in the border cells
+int Solver::UniformGrid::cellIndex(const sf::Vector2f& pos) const {
+    sf::Vector2i cell = worldToCell(pos);
+    int x = std::clamp(cell.x, 0, cols - 1);
+    int y = std::clamp(cell.y, 0, rows - 1);
+    return y * cols + x;
 }
 
-void Solver::SpatialHashGrid::clear() {
-    grid.clear();
+// counting sort: count particles per cell, prefix sum the counts plus some free room per cell and
+// place the indices. Walking forwards keeps the indices inside a cell in ascending order.
+void Solver::UniformGrid::build(const std::vector<sf::Vector2f>& positions) {
+    const int count = static_cast<int>(positions.size());
+    const int cells = cols * rows;
+
+    particleCell.resize(count);
+    particleSlot.resize(count);
+    cellCount.assign(cells, 0);
+
+    for (int i = 0; i < count; ++i) {
+        int cell = cellIndex(positions[i]);
+        particleCell[i] = cell;
+        ++cellCount[cell];
+    }
+
+    // a cell gets room for half again its particles, empty ones a little, so particles moving in
+    // between rebuilds find a free slot
+    int offset = 0;
+    for (int c = 0; c < cells; ++c) {
+        cellStart[c] = offset;
+        offset += cellCount[c] + 2 + cellCount[c] / 2;
+        cellCount[c] = 0;
+    }
+    cellStart[cells] = offset;
+    cellParticles.assign(offset, -1);
+
+    for (int i = 0; i < count; ++i) {
+        int cell = particleCell[i];
+        int slot = cellStart[cell] + cellCount[cell]++;
+        cellParticles[slot] = i;
+        particleSlot[i] = slot;
+    }
+
+    needsRebuild = false;
+    movedLastUpdate = count;
+}
+
+// moves only the particles that crossed in to another cell, each one in O(1): the last particle of its
+// old cell fills the gap and it takes the next free slot of the new cell. A cell that ran out of free
+// slots is only fixed by handing out new room, so the grid is rebuilt then.
+void Solver::UniformGrid::update(const std::vector<sf::Vector2f>& positions) {
+    const int count = static_cast<int>(positions.size());
+    if (needsRebuild || count != static_cast<int>(particleCell.size())) {
+        build(positions);
+        return;
+    }
+
+    movedLastUpdate = 0;
+    for (int i = 0; i < count; ++i) {
+        int from = particleCell[i];
+        int to = cellIndex(positions[i]);
+        if (to == from) continue;
+
+        if (cellStart[to] + cellCount[to] == cellStart[to + 1]) {
+            build(positions);
+            return;
+        }
+
+        relocate(i, from, to);
+        ++movedLastUpdate;
+    }
+}
+
+void Solver::UniformGrid::relocate(int index, int from, int to) {
+    int slot = particleSlot[index];
+    int last = cellStart[from] + --cellCount[from];
+    int filler = cellParticles[last];
+    cellParticles[slot] = filler;
+    particleSlot[filler] = slot;
+    cellParticles[last] = -1;
+
+    int free = cellStart[to] + cellCount[to]++;
+    cellParticles[free] = index;
+    particleSlot[index] = free;
+    particleCell[index] = to;
 }
 
 // Solver
 Solver::Solver() = default;
 
-Particle& Solver::addObject(sf::Vector2f position, float radius) {
-    Particle newParticle(position, radius);
-    return objects.emplace_back(newParticle);
+Solver::ParticleHandle Solver::addObject(sf::Vector2f position, float radius) {
+    int index = static_cast<int>(positions.size());
+
+    // a new particle starts at rest, its previous position is where it is. Keeping the array in step
+    // matters when paging adds and removes particles in the same step, the sizes would match again
+    // but the indices would not.
+    if (positionsPrevious.size() == positions.size())
+        positionsPrevious.push_back(position);
+    positions.push_back(position);
+    positionsLast.push_back(position);
+    accelerations.push_back({ 0.f, 0.f });
+    radii.push_back(radius);
+    sleeping.push_back(0);
+    restingSteps.push_back(0);
+    motion.push_back(0.f);
+    lodWaited.push_back(0);
+    lodInterval.push_back(1);
+
+    int slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else {
+        slot = static_cast<int>(slots.size());
+        slots.emplace_back();
+    }
+    slots[slot].index = index;
+    handleSlot.push_back(slot);
+
+    ParticleHandle handle;
+    handle.slot = slot;
+    handle.generation = slots[slot].generation;
+    return handle;
 }
 
-void Solver::update(const sf::RectangleShape& rect) {
-    applyGravity();
+bool Solver::removeObject(ParticleHandle handle) {
+    int index = getIndex(handle);
+    if (index < 0) return false;
 
-    sf::Vector2f rectTopLeft = rect.getPosition() - rect.getOrigin();
-    hashGrid.clear();
+    removeAt(index);
+    return true;
+}
+
+// swap and pop keeps the arrays dense, the grid has to be rebuilt as the last particle changed index
+void Solver::removeAt(int index) {
+    int slot = handleSlot[index];
+    int last = getObjectCount() - 1;
+    if (index != last) {
+        positions[index] = positions[last];
+        positionsLast[index] = positionsLast[last];
+        accelerations[index] = accelerations[last];
+        radii[index] = radii[last];
+        sleeping[index] = sleeping[last];
+        restingSteps[index] = restingSteps[last];
+        motion[index] = motion[last];
+        lodWaited[index] = lodWaited[last];
+        lodInterval[index] = lodInterval[last];
+        handleSlot[index] = handleSlot[last];
+        slots[handleSlot[index]].index = index;
+        if (static_cast<int>(positionsPrevious.size()) == last + 1)
+            positionsPrevious[index] = positionsPrevious[last];
+    }
+
+    positions.pop_back();
+    positionsLast.pop_back();
+    accelerations.pop_back();
+    radii.pop_back();
+    sleeping.pop_back();
+    restingSteps.pop_back();
+    motion.pop_back();
+    lodWaited.pop_back();
+    lodInterval.pop_back();
+    handleSlot.pop_back();
+    if (static_cast<int>(positionsPrevious.size()) == last + 1)
+        positionsPrevious.pop_back();
+
+    slots[slot].index = -1;
+    ++slots[slot].generation;
+    freeSlots.push_back(slot);
+
+    grid.needsRebuild = true;
+}
+
+int Solver::getIndex(ParticleHandle handle) const {
+    if (handle.slot < 0 || handle.slot >= static_cast<int>(slots.size())) return -1;
+
+    const HandleSlot& slot = slots[handle.slot];
+    return slot.generation == handle.generation ? slot.index : -1;
+}
+
+Solver::ParticleHandle Solver::getHandle(int index) const {
+    ParticleHandle handle;
+    handle.slot = handleSlot[index];
+    handle.generation = slots[handle.slot].generation;
+    return handle;
+}
+
+bool Solver::isAlive(ParticleHandle handle) const {
+    return getIndex(handle) >= 0;
+}
 
-    for (int i = 0; i < objects.size(); ++i)
-        hashGrid.insert(objects[i].position, i, rectTopLeft);
+void Solver::clear() {
+    positionsPrevious.clear();
+    accumulator = 0.f;
+    positions.clear();
+    positionsLast.clear();
+    accelerations.clear();
+    radii.clear();
+    sleeping.clear();
+    restingSteps.clear();
+    motion.clear();
+    lodWaited.clear();
+    lodInterval.clear();
+    stepsSinceReorder = 0;
+    activeAreaSet = false;      // the next level sets its own areas
+    focusAreaSet = false;
+    pages.clear();
+    pagedOutCount = 0;
+    pagesDirty = true;
 
-    for (int i = 0; i < 3; ++i) {
-        for (auto& obj : objects) {
-            obj.solveBoundaries(rect);
-            obj.update(step_dt);
+    // every handle handed out so far goes stale, the slots are kept for the next particles
+    for (int slot : handleSlot) {
+        slots[slot].index = -1;
+        ++slots[slot].generation;
+        freeSlots.push_back(slot);
+    }
+    handleSlot.clear();
+}
+
+void Solver::assignObjects(const std::vector<sf::Vector2f>& newPositions, const std::vector<float>& newRadii) {
+    clear();
+
+    size_t count = newPositions.size();
+    positions.assign(newPositions.begin(), newPositions.end());
+    positionsLast.assign(newPositions.begin(), newPositions.end());
+    accelerations.assign(count, { 0.f, 0.f });
+    radii.assign(newRadii.begin(), newRadii.end());
+    sleeping.assign(count, 0);
+    restingSteps.assign(count, 0);
+    motion.assign(count, 0.f);
+    lodWaited.assign(count, 0);
+    lodInterval.assign(count, 1);
+
+    // stale slots are reused first like addObject does, fresh ones after that
+    handleSlot.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        int slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
         }
-        checkCollisionsSpatial(rect);
+        else {
+            slot = static_cast<int>(slots.size());
+            slots.emplace_back();
+        }
+        slots[slot].index = static_cast<int>(i);
+        handleSlot[i] = slot;
+    }
+
+    grid.needsRebuild = true;
+}
+
+// Fixed timestep: frame time is collected and spent in steps of fixed_dt so the simulation runs the same
+// at any frame rate. After a long hitch only maxStepsPerUpdate steps are run and the rest of the owed time is
+// dropped, otherwise every slow frame would make the next one slower.
+void Solver::update(const sf::RectangleShape& rect, float frameTime) {
+    TRACE_ZONE("Solver::update");
+    accumulator += frameTime;
+
+    int steps = static_cast<int>(accumulator / fixed_dt);
+    if (steps > maxStepsPerUpdate) {
+        steps = maxStepsPerUpdate;
+        accumulator = steps * fixed_dt + std::fmod(accumulator, fixed_dt);
     }
+
+    for (int i = 0; i < steps; ++i) {
+        // only the state before the last step is needed for interpolating
+        if (i == steps - 1)
+            positionsPrevious = positions;
+
+        step(rect);
+        accumulator -= fixed_dt;
+    }
+
+    accumulator = std::max(accumulator, 0.f);
 }
-// visualising grid
-void Solver::drawGrid(const sf::RectangleShape& rect, sf::RenderWindow& window) {
-    float cellSize = hashGrid.cellSize;
-    sf::RectangleShape cellOutline;
-    cellOutline.setSize(sf::Vector2f(cellSize, cellSize));
-    cellOutline.setFillColor(sf::Color::Transparent);
-    cellOutline.setOutlineColor(sf::Color(60, 60, 60, 120));
-    cellOutline.setOutlineThickness(1.f);
 
+void Solver::step(const sf::RectangleShape& rect) {
+    TRACE_ZONE("Solver::step");
     sf::Vector2f rectTopLeft = rect.getPosition() - rect.getOrigin();
-    int startCol = 0;
-    int endCol = static_cast<int>(std::ceil(rect.getSize().x / cellSize));
-    int startRow = 0;
-    int endRow = static_cast<int>(std::ceil(rect.getSize().y / cellSize));
 
-    for (int x = startCol; x < endCol; x++) {
-        for (int y = startRow; y < endRow; y++) {
-            cellOutline.setPosition(rectTopLeft + sf::Vector2f(x * cellSize, y * cellSize));
-            window.draw(cellOutline);
-        }
+    // moving walls can leave sleeping particles hanging in the air
+    sf::FloatRect bounds(rectTopLeft, rect.getSize());
+    if (bounds.position != lastBounds.position || bounds.size != lastBounds.size) {
+        pageAllIn();
+        wakeAll();
+        lastBounds = bounds;
+        pagesDirty = true;
+    }
+
+    // the grid only covers the particles left in the solver
+    updatePages();
+    if (activeAreaSet)
+        grid.resize(residentArea.position, residentArea.size);
+    else
+        grid.resize(rectTopLeft, rect.getSize());
+
+    updateLod();
+    applyGravity();
+    applyForceEmitters();
+
+    // the grid follows the particles every substep so contacts are not missed
+    for (int i = 0; i < substeps; ++i) {
+        updateObjects(rect, step_dt);
+        solveTileCollisions();
+        grid.update(positions);
+        checkCollisionsSpatial();
     }
+
+    wakeUnsupported();
+    updateSleeping();
+    finishLod();
+    maybeReorder();
+    ++stepCount;
+
+    TRACE_COUNTER("awake particles", getAwakeCount());
+    TRACE_COUNTER("pairs tested", stats.pairsTested);
+}
+
+void Solver::setSubsteps(int count) {
+    substeps = std::max(1, count);
+    updateSubstepTime();
+}
+
+void Solver::updateSubstepTime() {
+    step_dt = fixed_dt / substeps;
+    substepScale = step_dt / referenceSubstepDt;
+    substepDamping = std::pow(0.99f, substepScale);
+}
+
+int Solver::getSubsteps() const {
+    return substeps;
+}
+
+void Solver::setFixedTimestep(float seconds) {
+    fixed_dt = seconds;
+    updateSubstepTime();
+}
+
+float Solver::getFixedTimestep() const {
+    return fixed_dt;
+}
+
+void Solver::setMaxStepsPerUpdate(int count) {
+    maxStepsPerUpdate = std::max(1, count);
+}
+
+float Solver::getInterpolationAlpha() const {
+    return std::min(accumulator / fixed_dt, 1.f);
+}
+
+long long Solver::getStepCount() const { return stepCount; }
+
+void Solver::setTileGrid(const TileGrid* tileGrid) {
+    tiles = tileGrid;
 }
 
-std::vector<Particle>& Solver::getObjects() { return objects; }
+void Solver::setThreadCount(int count) {
+    if (count == getThreadCount()) return;
 
+    if (count > 1)
+        pool = std::make_unique<ThreadPool>(count);
+    else
+        pool.reset();
+}
+
+int Solver::getThreadCount() const {
+    return pool ? pool->getThreadCount() : 1;
+}
+
+float Solver::getGridCellSize() const { return grid.cellSize; }
+
+const Solver::Stats& Solver::getStats() const { return stats; }
+
+void Solver::resetStats() { stats = Stats(); }
+
+int Solver::getObjectCount() const { return static_cast<int>(positions.size()); }
+
+const std::vector<sf::Vector2f>& Solver::getPositions() const { return positions; }
+
+const std::vector<sf::Vector2f>& Solver::getPreviousPositions() const { return positionsPrevious; }
+
+const std::vector<float>& Solver::getRadii() const { return radii; }
+
+// Physics
+void Solver::setVelocity(int index, sf::Vector2f v, float dt) {
+    wake(index);
+    positionsLast[index] = positions[index] - (v * dt);
+}
+
+void Solver::addVelocity(int index, sf::Vector2f v, float dt) {
+    wake(index);
+    positionsLast[index] -= v * dt;
+}
+
+sf::Vector2f Solver::getVelocity(int index) const { return positions[index] - positionsLast[index]; }
+
+// sleeping particles are not integrated so they would only pile up acceleration.
+// Only the first substep integrates the acceleration, so it carries the change of the whole step
 void Solver::applyGravity() {
-    for (auto& obj : objects)
-        obj.applyAcceleration(gravity);
+    sf::Vector2f stepGravity = gravity * static_cast<float>(substeps);
+    for (size_t i = 0; i < accelerations.size(); ++i) {
+        if (!sleeping[i])
+            accelerations[i] += stepGravity;
+    }
 }
 
-// checks grid cells inside the map area detecting distances between particles and if close enough psuhes them away
-void Solver::checkCollisionsSpatial(const sf::RectangleShape& rect) {
-    sf::Vector2f rectTopLeft = rect.getPosition() - rect.getOrigin();
-    sf::Vector2f rectBottomRight = rectTopLeft + rect.getSize();
-
-    for (auto& [key, cellParticles] : hashGrid.grid) {
-        int cx = static_cast<int>(key >> 32);
-        int cy = static_cast<int>(key & 0xFFFFFFFF);
-
-        float cellLeft = rectTopLeft.x + cx * hashGrid.cellSize;
-        float cellRight = cellLeft + hashGrid.cellSize;
-        float cellTop = rectTopLeft.y + cy * hashGrid.cellSize;
-        float cellBottom = cellTop + hashGrid.cellSize;
-
-        if (cellRight < rectTopLeft.x || cellLeft > rectBottomRight.x ||
-            cellBottom < rectTopLeft.y || cellTop > rectBottomRight.y) continue;
-
-        for (int dx = -1; dx <= 1; ++dx) {
-            for (int dy = -1; dy <= 1; ++dy) {
-                long long neighborKey = hashGrid.hash(cx + dx, cy + dy);
-                auto it = hashGrid.grid.find(neighborKey);
-                if (it == hashGrid.grid.end()) continue;
-
-                const auto& neighborParticles = it->second;
-                for (int i : cellParticles) {
-                    Particle& obj1 = objects[i];
-                    for (int j : neighborParticles) {
-                        if (j <= i) continue;
-                        Particle& obj2 = objects[j];
-
-                        sf::Vector2f v = obj1.position - obj2.position;
-                        float dist = std::sqrt(v.x * v.x + v.y * v.y);
-                        float min_dist = obj1.radius + obj2.radius;
-                        if (dist < min_dist) {
-                            sf::Vector2f n = dist > 0.0001f ? v / dist : sf::Vector2f(1.f, 0.f);
-                            float delta = 0.8f * (min_dist - dist);
-                            obj1.position += n * 0.5f * delta;
-                            obj2.position -= n * 0.5f * delta;
-                            float damping = 0.99f;
-                            obj1.position_last = obj1.position - (obj1.position - obj1.position_last) * damping;
-                            obj2.position_last = obj2.position - (obj2.position - obj2.position_last) * damping;
+// keeps particles inside the map rectangle, bouncing them back from the edges, and does the verlet step
+void Solver::updateObjects(const sf::RectangleShape& rect, float dt) {
+    float outline = rect.getOutlineThickness();
+
+    // Compute top-left and bottom-right based on origin and size
+    sf::Vector2f rectTopLeft = rect.getPosition() - rect.getOrigin() - sf::Vector2f(outline, outline);
+    sf::Vector2f rectBottomRight = rectTopLeft + rect.getSize() + sf::Vector2f(outline * 2.f, outline * 2.f);
+
+    ParticleKernels::Bounds bounds{ rectTopLeft.x, rectTopLeft.y, rectBottomRight.x, rectBottomRight.y };
+    float damping = substepDamping;
+    float b = 0.95f; // bounce factor
+
+    // frozen and idle particles are skipped even with sleeping off
+    bool skipSleeping = sleepingEnabled || activeAreaSet || focusAreaSet;
+    ParticleKernels::integrate(positions.data(), positionsLast.data(), accelerations.data(), radii.data(),
+        skipSleeping ? sleeping.data() : nullptr, getObjectCount(), bounds, dt, damping, b);
+}
+
+// checks each grid cell against its neighbour cells detecting distances between particles and if close enough psuhes them away.
+// The cells are split in to 3x3 colours, cells of one colour are three cells apart so their neighbourhoods never
+// overlap and a colour can be solved on many threads at once. The colour order is the same for any thread count
+// so the results do not depend on it.
+void Solver::checkCollisionsSpatial() {
+    TRACE_ZONE("Solver::checkCollisionsSpatial");
+    countAwakePerCell();
+
+    for (int oy = 0; oy < 3; ++oy) {
+        for (int ox = 0; ox < 3; ++ox) {
+            int colourRows = (grid.rows - oy + 2) / 3;
+
+            // every row counts its own pairs so threads never share a counter
+            rowStats.assign(colourRows, Stats());
+
+            auto solveRow = [this, ox, oy](int k) {
+                int cy = oy + 3 * k;
+                Stats& local = rowStats[k];
+                for (int cx = ox; cx < grid.cols; cx += 3)
+                    solveCell(cx, cy, local);
+            };
+
+            if (pool)
+                pool->parallelFor(colourRows, solveRow);
+            else
+                for (int k = 0; k < colourRows; ++k)
+                    solveRow(k);
+
+            for (const Stats& row : rowStats) {
+                stats.pairsTested += row.pairsTested;
+                stats.pairsResolved += row.pairsResolved;
+            }
+        }
+    }
+}
+
+void Solver::solveCell(int cx, int cy, Stats& cellStats) {
+    int cell = cy * grid.cols + cx;
+    int cellBegin = grid.cellStart[cell];
+    int cellEnd = grid.cellEnd(cell);
+    if (cellBegin == cellEnd) return;
+
+    // settled water: nothing here or next door can move
+    if (isQuietNeighbourhood(cx, cy)) return;
+
+    const float wakeLimit = wakeVelocity * wakeVelocity * substepScale * substepScale;
+
+    for (int dx = -1; dx <= 1; ++dx) {
+        int nx = cx + dx;
+        if (nx < 0 || nx >= grid.cols) continue;
+
+        for (int dy = -1; dy <= 1; ++dy) {
+            int ny = cy + dy;
+            if (ny < 0 || ny >= grid.rows) continue;
+
+            int neighbor = ny * grid.cols + nx;
+            int neighborBegin = grid.cellStart[neighbor];
+            int neighborEnd = grid.cellEnd(neighbor);
+
+            for (int a = cellBegin; a < cellEnd; ++a) {
+                int i = grid.cellParticles[a];
+                for (int b = neighborBegin; b < neighborEnd; ++b) {
+                    int j = grid.cellParticles[b];
+                    if (j <= i) continue;
+                    if (sleeping[i] && sleeping[j]) continue;
+
+                    ++cellStats.pairsTested;
+
+                    sf::Vector2f v = positions[i] - positions[j];
+                    float dist = std::sqrt(v.x * v.x + v.y * v.y);
+                    float min_dist = radii[i] + radii[j];
+                    if (dist < min_dist) {
+                        ++cellStats.pairsResolved;
+                        sf::Vector2f n = dist > 0.0001f ? v / dist : sf::Vector2f(1.f, 0.f);
+                        float delta = 0.8f * (min_dist - dist);
+
+                        // a slow particle leaning on a sleeping one is pushed off it alone,
+                        // a fast one wakes the sleeper and both move. Frozen and idle ones never wake.
+                        if (sleeping[i] || sleeping[j]) {
+                            int awake = sleeping[i] ? j : i;
+                            int sleeper = sleeping[i] ? i : j;
+                            sf::Vector2f velocity = positions[awake] - positionsLast[awake];
+                            if (sleeping[sleeper] < frozenFlag &&
+                                velocity.x * velocity.x + velocity.y * velocity.y > wakeLimit) {
+                                wake(sleeper);
+                            }
+                            else {
+                                positions[awake] += (awake == i ? n : -n) * delta;
+                                float damping = substepDamping;
+                                positionsLast[awake] = positions[awake] - (positions[awake] - positionsLast[awake]) * damping;
+                                continue;
+                            }
                         }
+
+                        positions[i] += n * 0.5f * delta;
+                        positions[j] -= n * 0.5f * delta;
+                        float damping = substepDamping;
+                        positionsLast[i] = positions[i] - (positions[i] - positionsLast[i]) * damping;
+                        positionsLast[j] = positions[j] - (positions[j] - positionsLast[j]) * damping;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void Solver::countAwakePerCell() {
+    cellAwake.assign(static_cast<size_t>(grid.cols) * grid.rows, 0);
+    for (size_t i = 0; i < sleeping.size(); ++i) {
+        if (!sleeping[i])
+            ++cellAwake[grid.particleCell[i]];
+    }
+}
+
+bool Solver::isQuietNeighbourhood(int cx, int cy) const {
+    for (int ny = std::max(cy - 1, 0); ny <= std::min(cy + 1, grid.rows - 1); ++ny) {
+        for (int nx = std::max(cx - 1, 0); nx <= std::min(cx + 1, grid.cols - 1); ++nx) {
+            if (cellAwake[ny * grid.cols + nx] > 0)
+                return false;
+        }
+    }
+    return true;
+}
+
+// A sleeper only meets awake particles that move in to it, so one whose support falls or is taken away
+// would hang in the air. A cell holding fewer particles than after the last step lost some of them,
+// the sleepers in it, beside it and in the row above may have rested on those and are woken.
+// The jitter inside a settling pile rarely moves particles between cells so waking does not spread.
+void Solver::wakeUnsupported() {
+    const int cellCount = grid.cols * grid.rows;
+    bool sameGrid = static_cast<int>(cellCountLast.size()) == cellCount && cellCountOrigin == grid.origin;
+    cellStirred.assign(cellCount, 0);
+    cellCountLast.resize(cellCount);
+    cellCountOrigin = grid.origin;
+
+    bool stirred = false;
+    for (int c = 0; c < cellCount; ++c) {
+        int count = grid.cellCount[c];
+        if (sameGrid && count < cellCountLast[c]) {
+            cellStirred[c] = 1;
+            stirred = true;
+        }
+        cellCountLast[c] = count;
+    }
+    if (!sleepingEnabled || !stirred) return;
+
+    for (size_t i = 0; i < positions.size(); ++i) {
+        if (sleeping[i] != 1) continue;
+
+        int cell = grid.particleCell[i];
+        int cx = cell % grid.cols;
+        int cy = cell / grid.cols;
+        bool unsupported = false;
+        for (int ny = cy; ny <= std::min(cy + 1, grid.rows - 1) && !unsupported; ++ny) {
+            for (int nx = std::max(cx - 1, 0); nx <= std::min(cx + 1, grid.cols - 1); ++nx) {
+                if (cellStirred[ny * grid.cols + nx]) {
+                    unsupported = true;
+                    break;
+                }
+            }
+        }
+        if (unsupported) {
+            // a sleeper that is still held up settles again after a short look instead of a full sleepSteps
+            wake(static_cast<int>(i));
+            restingSteps[i] = std::max(0, sleepSteps - supportProbeSteps);
+        }
+    }
+}
+
+// particles that stayed slow long enough fall asleep, their velocity is dropped so they wake up at rest.
+// The speed is smoothed over a few steps so the small jitter inside a settled pile does not keep
+// resetting the count.
+void Solver::updateSleeping() {
+    if (!sleepingEnabled) return;
+
+    const float limit = sleepVelocity * sleepVelocity * substepScale * substepScale;
+    for (size_t i = 0; i < positions.size(); ++i) {
+        if (sleeping[i]) continue;
+
+        sf::Vector2f velocity = positions[i] - positionsLast[i];
+        motion[i] = motion[i] * 0.8f + (velocity.x * velocity.x + velocity.y * velocity.y) * 0.2f;
+
+        if (motion[i] < limit) {
+            // a particle of a slower region rested through the steps it sat out as well
+            restingSteps[i] += lodInterval[i];
+            if (restingSteps[i] >= sleepSteps) {
+                sleeping[i] = 1;
+                positionsLast[i] = positions[i];
+                accelerations[i] = {};
+            }
+        }
+        else {
+            restingSteps[i] = 0;
+        }
+    }
+}
+
+void Solver::setSleepingEnabled(bool enabled) {
+    sleepingEnabled = enabled;
+    if (!enabled)
+        wakeAll();
+}
+
+void Solver::setSleepThreshold(float velocity, int steps) {
+    sleepVelocity = velocity;
+    sleepSteps = std::max(1, steps);
+}
+
+bool Solver::isSleeping(int index) const {
+    return sleeping[index] != 0;
+}
+
+int Solver::getAwakeCount() const {
+    return static_cast<int>(std::count(sleeping.begin(), sleeping.end(), 0));
+}
+
+void Solver::wake(int index) {
+    if (sleeping[index] >= frozenFlag) return;
+    sleeping[index] = 0;
+    restingSteps[index] = 0;
+    motion[index] = sleepVelocity * sleepVelocity * substepScale * substepScale;
+}
+
+void Solver::wakeAll() {
+    for (size_t i = 0; i < sleeping.size(); ++i)
+        wake(static_cast<int>(i));
+}
+
+void Solver::setActiveArea(const sf::FloatRect& area) {
+    if (!activeAreaSet || area.position != activeArea.position || area.size != activeArea.size)
+        pagesDirty = true;
+    activeArea = area;
+    activeAreaSet = true;
+}
+
+void Solver::clearActiveArea() {
+    activeAreaSet = false;
+    pageAllIn();
+    pagesDirty = true;
+    for (size_t i = 0; i < sleeping.size(); ++i) {
+        if (sleeping[i] == frozenFlag) {
+            sleeping[i] = 0;
+            wake(static_cast<int>(i));
+        }
+    }
+}
+
+int Solver::getFrozenCount() const {
+    return static_cast<int>(std::count(sleeping.begin(), sleeping.end(), frozenFlag));
+}
+
+int Solver::getPagedOutCount() const { return pagedOutCount; }
+
+int Solver::pageOf(const sf::Vector2f& position) const {
+    int px = std::clamp(static_cast<int>(std::floor((position.x - lastBounds.position.x) / pageSize)), 0, pageCols - 1);
+    int py = std::clamp(static_cast<int>(std::floor((position.y - lastBounds.position.y) / pageSize)), 0, pageRows - 1);
+    return py * pageCols + px;
+}
+
+// pages touching the active area run, the pages next to those are frozen and the rest is paged out.
+// Pages that are not out any more get their particles back, the resident area is the box around them.
+void Solver::updatePageStates() {
+    pageCols = std::max(static_cast<int>(std::ceil(lastBounds.size.x / pageSize)), 1);
+    pageRows = std::max(static_cast<int>(std::ceil(lastBounds.size.y / pageSize)), 1);
+    if (pages.size() != static_cast<size_t>(pageCols) * pageRows) {
+        pageAllIn();
+        pages.assign(static_cast<size_t>(pageCols) * pageRows, Page());
+    }
+
+    const sf::Vector2f origin = lastBounds.position;
+    sf::Vector2f activeEnd = activeArea.position + activeArea.size;
+    for (int py = 0; py < pageRows; ++py) {
+        for (int px = 0; px < pageCols; ++px) {
+            sf::Vector2f low = origin + sf::Vector2f(px * pageSize, py * pageSize);
+            sf::Vector2f high = low + sf::Vector2f(pageSize, pageSize);
+            bool active = low.x < activeEnd.x && high.x > activeArea.position.x &&
+                low.y < activeEnd.y && high.y > activeArea.position.y;
+            pages[static_cast<size_t>(py) * pageCols + px].state = active ? PageState::Active : PageState::Out;
+        }
+    }
+
+    int minX = pageCols, minY = pageRows, maxX = -1, maxY = -1;
+    for (int py = 0; py < pageRows; ++py) {
+        for (int px = 0; px < pageCols; ++px) {
+            Page& page = pages[static_cast<size_t>(py) * pageCols + px];
+            if (page.state == PageState::Out) {
+                for (int ny = std::max(py - 1, 0); ny <= std::min(py + 1, pageRows - 1); ++ny) {
+                    for (int nx = std::max(px - 1, 0); nx <= std::min(px + 1, pageCols - 1); ++nx) {
+                        if (pages[static_cast<size_t>(ny) * pageCols + nx].state == PageState::Active)
+                            page.state = PageState::Frozen;
                     }
                 }
             }
+            if (page.state == PageState::Out) continue;
+
+            minX = std::min(minX, px);
+            minY = std::min(minY, py);
+            maxX = std::max(maxX, px);
+            maxY = std::max(maxY, py);
+
+            for (size_t k = 0; k < page.positions.size(); ++k)
+                addObject(page.positions[k], page.radii[k]);
+            pagedOutCount -= static_cast<int>(page.positions.size());
+            page.positions.clear();
+            page.radii.clear();
+        }
+    }
+
+    // an area off the map leaves nothing resident, the grid shrinks to one cell
+    if (maxX < 0) {
+        residentArea = sf::FloatRect(origin, { 0.f, 0.f });
+    }
+    else {
+        sf::Vector2f low = origin + sf::Vector2f(minX * pageSize, minY * pageSize);
+        sf::Vector2f high = origin + sf::Vector2f((maxX + 1) * pageSize, (maxY + 1) * pageSize);
+        high.x = std::min(high.x, origin.x + lastBounds.size.x);
+        high.y = std::min(high.y, origin.y + lastBounds.size.y);
+        residentArea = sf::FloatRect(low, high - low);
+    }
+    pagesDirty = false;
+}
+
+// pages out the particles that are in an out page, freezes the ones in a frozen page and thaws the rest.
+// Freezing drops the velocity like falling asleep does, thawing wakes the particle so it settles again.
+void Solver::updatePages() {
+    if (!activeAreaSet) return;
+    if (pagesDirty)
+        updatePageStates();
+
+    // backwards, so the particle swapped in to a removed index was already looked at
+    for (int i = getObjectCount() - 1; i >= 0; --i) {
+        Page& page = pages[pageOf(positions[i])];
+        if (page.state == PageState::Out) {
+            page.positions.push_back(positions[i]);
+            page.radii.push_back(radii[i]);
+            ++pagedOutCount;
+            removeAt(i);
+        }
+        else if (page.state == PageState::Frozen) {
+            if (sleeping[i] != frozenFlag) {
+                sleeping[i] = frozenFlag;
+                positionsLast[i] = positions[i];
+                accelerations[i] = {};
+            }
+        }
+        else if (sleeping[i] == frozenFlag) {
+            sleeping[i] = 0;
+            wake(i);
+            lodWaited[i] = 0;
+        }
+    }
+}
+
+void Solver::pageAllIn() {
+    for (Page& page : pages) {
+        for (size_t k = 0; k < page.positions.size(); ++k)
+            addObject(page.positions[k], page.radii[k]);
+        page.positions.clear();
+        page.radii.clear();
+    }
+    pagedOutCount = 0;
+}
+
+void Solver::setFocusArea(const sf::FloatRect& area) {
+    focusArea = area;
+    focusAreaSet = true;
+}
+
+void Solver::clearFocusArea() {
+    focusAreaSet = false;
+    std::fill(regionRates.begin(), regionRates.end(), 1);
+    std::fill(lodWaited.begin(), lodWaited.end(), 0);
+    std::fill(lodInterval.begin(), lodInterval.end(), 1);
+}
+
+void Solver::setLodRegionSize(float size) {
+    lodRegionSize = std::max(size, 1.f);
+}
+
+void Solver::setMaxLodRate(int rate) {
+    // rates are powers of two so the region schedules line up when a rate halves or doubles
+    maxLodRate = 1;
+    while (maxLodRate * 2 <= std::min(rate, 64))
+        maxLodRate *= 2;
+}
+
+int Solver::getLodRegionCols() const { return regionCols; }
+
+int Solver::getLodRegionRows() const { return regionRows; }
+
+const std::vector<unsigned char>& Solver::getRegionRates() const { return regionRates; }
+
+int Solver::getIdleCount() const {
+    return static_cast<int>(std::count(sleeping.begin(), sleeping.end(), idleFlag));
+}
+
+// rate of every region from its distance to the focus area in regions: 1 next to it, doubling with
+// every region further out up to maxLodRate, 0 outside the active area. A rate moves by one doubling
+// per step at most, so regions the camera comes near are promoted back over a few steps.
+void Solver::updateRegionRates() {
+    const sf::Vector2f origin = lastBounds.position;
+    regionCols = std::max(static_cast<int>(std::ceil(lastBounds.size.x / lodRegionSize)), 1);
+    regionRows = std::max(static_cast<int>(std::ceil(lastBounds.size.y / lodRegionSize)), 1);
+    regionRates.resize(static_cast<size_t>(regionCols) * regionRows, 1);
+
+    sf::Vector2f focusEnd = focusArea.position + focusArea.size;
+    sf::Vector2f activeEnd = activeArea.position + activeArea.size;
+
+    for (int ry = 0; ry < regionRows; ++ry) {
+        for (int rx = 0; rx < regionCols; ++rx) {
+            sf::Vector2f low = origin + sf::Vector2f(rx * lodRegionSize, ry * lodRegionSize);
+            sf::Vector2f high = low + sf::Vector2f(lodRegionSize, lodRegionSize);
+
+            int target = 0;
+            bool active = !activeAreaSet ||
+                (low.x < activeEnd.x && high.x > activeArea.position.x && low.y < activeEnd.y && high.y > activeArea.position.y);
+            if (active) {
+                float gapX = std::max({ focusArea.position.x - high.x, low.x - focusEnd.x, 0.f });
+                float gapY = std::max({ focusArea.position.y - high.y, low.y - focusEnd.y, 0.f });
+                int distance = static_cast<int>(std::ceil(std::max(gapX, gapY) / lodRegionSize));
+
+                target = 1;
+                while (distance-- > 0 && target < maxLodRate)
+                    target *= 2;
+            }
+
+            unsigned char& rate = regionRates[static_cast<size_t>(ry) * regionCols + rx];
+            if (target == 0 || rate == 0)
+                rate = static_cast<unsigned char>(target);
+            else if (target < rate)
+                rate = static_cast<unsigned char>(rate / 2);
+            else if (target > rate)
+                rate = static_cast<unsigned char>(rate * 2);
+        }
+    }
+}
+
+int Solver::regionOf(const sf::Vector2f& position) const {
+    int rx = std::clamp(static_cast<int>(std::floor((position.x - lastBounds.position.x) / lodRegionSize)), 0, regionCols - 1);
+    int ry = std::clamp(static_cast<int>(std::floor((position.y - lastBounds.position.y) / lodRegionSize)), 0, regionRows - 1);
+    return ry * regionCols + rx;
+}
+
+// Particles of a region with rate n take part in every nth step only, time runs n times slower there.
+// All regions of one rate are due on the same steps so neighbours of a rate never meet idle. The rest
+// is marked idle for this step and treated like frozen particles, awake ones are pushed off them.
+// Stepping less often with a longer time step was tried, it squeezes stacked water and blows up at 4.
+void Solver::updateLod() {
+    if (!focusAreaSet) return;
+
+    TRACE_ZONE("Solver::updateLod");
+    updateRegionRates();
+
+    for (size_t i = 0; i < positions.size(); ++i) {
+        if (sleeping[i]) {
+            lodWaited[i] = 0;
+            continue;
+        }
+
+        int rate = std::max<int>(regionRates[regionOf(positions[i])], 1);
+        bool due = stepCount % rate == 0 || lodWaited[i] + 1 >= rate;
+        if (due) {
+            lodInterval[i] = static_cast<unsigned char>(lodWaited[i] + 1);
+            lodWaited[i] = 0;
+            continue;
+        }
+
+        sleeping[i] = idleFlag;
+        ++lodWaited[i];
+    }
+}
+
+void Solver::finishLod() {
+    if (!focusAreaSet) return;
+
+    TRACE_COUNTER("idle particles", getIdleCount());
+    for (unsigned char& flag : sleeping) {
+        if (flag == idleFlag)
+            flag = 0;
+    }
+}
+
+// pushes particles out of the solid map tiles, every particle only looks at the tiles its circle overlaps.
+// Particles do not affect each other here so they are split in to plain chunks for the threads.
+void Solver::solveTileCollisions() {
+    if (!tiles || tiles->empty()) return;
+
+    const int chunkSize = 1024;
+    int chunks = (getObjectCount() + chunkSize - 1) / chunkSize;
+
+    auto solveChunk = [this](int chunk) {
+        int begin = chunk * chunkSize;
+        solveTileCollisions(begin, std::min(begin + chunkSize, getObjectCount()));
+    };
+
+    if (pool)
+        pool->parallelFor(chunks, solveChunk);
+    else
+        for (int chunk = 0; chunk < chunks; ++chunk)
+            solveChunk(chunk);
+}
+
+void Solver::solveTileCollisions(int begin, int end) {
+    const float size = tiles->getTileSize();
+    const sf::Vector2f origin = tiles->getOrigin();
+
+    for (int i = begin; i < end; ++i) {
+        if (sleeping[i]) continue;
+
+        sf::Vector2f p = positions[i];
+        sf::Vector2f velocity = p - positionsLast[i];
+        float r = radii[i];
+        bool touched = false;
+
+        int col0 = static_cast<int>(std::floor((p.x - r - origin.x) / size));
+        int col1 = static_cast<int>(std::floor((p.x + r - origin.x) / size));
+        int row0 = static_cast<int>(std::floor((p.y - r - origin.y) / size));
+        int row1 = static_cast<int>(std::floor((p.y + r - origin.y) / size));
+
+        for (int row = row0; row <= row1; ++row) {
+            for (int col = col0; col <= col1; ++col) {
+                if (!tiles->isSolid(row, col)) continue;
+
+                float left = origin.x + col * size;
+                float top = origin.y + row * size;
+                float right = left + size;
+                float bottom = top + size;
+
+                // closest point of the tile to the particle centre
+                sf::Vector2f closest(std::clamp(p.x, left, right), std::clamp(p.y, top, bottom));
+                sf::Vector2f d = p - closest;
+                float dist2 = d.x * d.x + d.y * d.y;
+                if (dist2 >= r * r) continue;
+
+                sf::Vector2f n;
+                if (dist2 > 0.0001f) {
+                    float dist = std::sqrt(dist2);
+                    n = d / dist;
+                    p += n * (r - dist);
+                }
+                else {
+                    // centre already inside the tile, leave through the nearest side
+                    float toLeft = p.x - left;
+                    float toRight = right - p.x;
+                    float toTop = p.y - top;
+                    float toBottom = bottom - p.y;
+                    float nearest = std::min(std::min(toLeft, toRight), std::min(toTop, toBottom));
+
+                    if (nearest == toLeft) { p.x = left - r; n = { -1.f, 0.f }; }
+                    else if (nearest == toRight) { p.x = right + r; n = { 1.f, 0.f }; }
+                    else if (nearest == toTop) { p.y = top - r; n = { 0.f, -1.f }; }
+                    else { p.y = bottom + r; n = { 0.f, 1.f }; }
+                }
+
+                // the wall stops the motion in to it, sliding along it is kept
+                float into = velocity.x * n.x + velocity.y * n.y;
+                if (into < 0.f)
+                    velocity -= n * into;
+                touched = true;
+            }
+        }
+
+        if (touched) {
+            positions[i] = p;
+            positionsLast[i] = p - velocity;
         }
     }
 }
+
+// visits the cells under the rectangle, one extra cell around it catches particles that
+// collisions have pushed over a cell border since the grid was last updated
+void Solver::queryRect(const sf::FloatRect& area, std::vector<int>& out) const {
+    const int count = getObjectCount();
+
+    // grid not built for these particles yet, look at all of them
+    if (static_cast<int>(grid.particleCell.size()) != count || grid.needsRebuild) {
+        for (int i = 0; i < count; ++i) {
+            if (area.contains(positions[i]))
+                out.push_back(i);
+        }
+        return;
+    }
+
+    sf::Vector2i first = grid.worldToCell(area.position);
+    sf::Vector2i last = grid.worldToCell(area.position + area.size);
+    int x0 = std::max(first.x - 1, 0);
+    int y0 = std::max(first.y - 1, 0);
+    int x1 = std::min(last.x + 1, grid.cols - 1);
+    int y1 = std::min(last.y + 1, grid.rows - 1);
+
+    for (int cy = y0; cy <= y1; ++cy) {
+        for (int cx = x0; cx <= x1; ++cx) {
+            int cell = cy * grid.cols + cx;
+            for (int k = grid.cellStart[cell]; k < grid.cellEnd(cell); ++k) {
+                int i = grid.cellParticles[k];
+                if (area.contains(positions[i]))
+                    out.push_back(i);
+            }
+        }
+    }
+}
+
+void Solver::queryRadius(const sf::Vector2f& center, float radius, std::vector<int>& out) const {
+    size_t begin = out.size();
+    queryRect(sf::FloatRect(center - sf::Vector2f(radius, radius), sf::Vector2f(radius * 2.f, radius * 2.f)), out);
+
+    // keep the ones inside the circle
+    float radius2 = radius * radius;
+    auto inside = std::remove_if(out.begin() + begin, out.end(), [&](int i) {
+        sf::Vector2f d = positions[i] - center;
+        return d.x * d.x + d.y * d.y > radius2;
+    });
+    out.erase(inside, out.end());
+}
+
+// frozen particles are left alone like gravity leaves sleeping ones, they cannot wake up to move
+// and the push would wait for the thaw to be applied all at once
+int Solver::applyRadialImpulse(const sf::Vector2f& center, float radius, float strength, float dt) {
+    queryResults.clear();
+    queryRadius(center, radius, queryResults);
+
+    int pushed = 0;
+    for (int i : queryResults) {
+        if (sleeping[i] >= frozenFlag) continue;
+
+        ++pushed;
+        sf::Vector2f dir = positions[i] - center;
+        float length = std::sqrt(dir.x * dir.x + dir.y * dir.y);
+        if (length != 0) dir /= length;
+
+        addVelocity(i, dir * strength, dt);
+    }
+    return pushed;
+}
+
+int Solver::addForceEmitter(const sf::Vector2f& position, float radius, float strength) {
+    ForceEmitter emitter;
+    emitter.position = position;
+    emitter.radius = radius;
+    emitter.strength = strength;
+    emitter.id = nextEmitterId++;
+    emitters.push_back(emitter);
+    return emitter.id;
+}
+
+void Solver::setForceEmitterPosition(int id, const sf::Vector2f& position) {
+    for (auto& emitter : emitters) {
+        if (emitter.id == id)
+            emitter.position = position;
+    }
+}
+
+void Solver::removeForceEmitter(int id) {
+    emitters.erase(std::remove_if(emitters.begin(), emitters.end(),
+        [id](const ForceEmitter& emitter) { return emitter.id == id; }), emitters.end());
+}
+
+void Solver::clearForceEmitters() {
+    emitters.clear();
+}
+
+// the force fades out linearly towards the edge of the emitter
+// frozen and idle particles skip the step, a force on them would pile up until they take part again
+void Solver::applyForceEmitters() {
+    for (const auto& emitter : emitters) {
+        queryResults.clear();
+        queryRadius(emitter.position, emitter.radius, queryResults);
+
+        for (int i : queryResults) {
+            if (sleeping[i] >= frozenFlag) continue;
+
+            sf::Vector2f dir = positions[i] - emitter.position;
+            float length = std::sqrt(dir.x * dir.x + dir.y * dir.y);
+            if (length != 0) dir /= length;
+
+            float falloff = 1.f - length / emitter.radius;
+            wake(i);
+            accelerations[i] += dir * (emitter.strength * falloff * substeps);
+        }
+    }
+}
+
+void Solver::setReorderInterval(int steps) { reorderInterval = std::max(0, steps); }
+
+void Solver::setReorderThreshold(float disorder) { reorderThreshold = disorder; }
+
+float Solver::measureDisorder() const {
+    const int count = getObjectCount();
+    if (count == 0 || static_cast<int>(grid.particleCell.size()) != count) return 0.f;
+
+    int scattered = 0;
+    for (int cell = 0; cell < grid.cols * grid.rows; ++cell) {
+        for (int k = grid.cellStart[cell] + 1; k < grid.cellEnd(cell); ++k) {
+            if (grid.cellParticles[k] != grid.cellParticles[k - 1] + 1)
+                ++scattered;
+        }
+    }
+    return static_cast<float>(scattered) / count;
+}
+
+void Solver::maybeReorder() {
+    ++stepsSinceReorder;
+
+    bool due = reorderInterval > 0 && stepsSinceReorder >= reorderInterval;
+    if (!due && reorderThreshold > 0.f && stepsSinceReorder % disorderCheckSteps == 0)
+        due = measureDisorder() > reorderThreshold;
+
+    if (due)
+        reorder();
+}
+
+namespace {
+    // spreads the low 16 bits out to the even bits
+    std::uint32_t spreadBits(std::uint32_t v) {
+        v &= 0x0000FFFF;
+        v = (v | (v << 8)) & 0x00FF00FF;
+        v = (v | (v << 4)) & 0x0F0F0F0F;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+        return v;
+    }
+
+    // the scratch array is kept per type so sorting never allocates once it has grown,
+    // and values keeps its own capacity
+    template <typename T>
+    void applyOrder(std::vector<T>& values, const std::vector<int>& order) {
+        static thread_local std::vector<T> sorted;
+        sorted.clear();
+        for (int from : order)
+            sorted.push_back(values[from]);
+        std::copy(sorted.begin(), sorted.end(), values.begin());
+    }
+}
+
+// sorts every particle array by the Z-order key of the grid cell, ties keep their current order
+void Solver::reorder() {
+    TRACE_ZONE("Solver::reorder");
+    stepsSinceReorder = 0;
+
+    const int count = getObjectCount();
+    if (count < 2) return;
+
+    reorderKeys.resize(count);
+    for (int i = 0; i < count; ++i) {
+        sf::Vector2i cell = grid.worldToCell(positions[i]);
+        std::uint32_t x = static_cast<std::uint32_t>(std::clamp(cell.x, 0, grid.cols - 1));
+        std::uint32_t y = static_cast<std::uint32_t>(std::clamp(cell.y, 0, grid.rows - 1));
+        reorderKeys[i] = { spreadBits(x) | (spreadBits(y) << 1), i };
+    }
+    std::sort(reorderKeys.begin(), reorderKeys.end());
+
+    reorderOrder.resize(count);
+    for (int i = 0; i < count; ++i)
+        reorderOrder[i] = reorderKeys[i].second;
+
+    applyOrder(positions, reorderOrder);
+    applyOrder(positionsLast, reorderOrder);
+    applyOrder(accelerations, reorderOrder);
+    applyOrder(radii, reorderOrder);
+    applyOrder(sleeping, reorderOrder);
+    applyOrder(restingSteps, reorderOrder);
+    applyOrder(motion, reorderOrder);
+    applyOrder(lodWaited, reorderOrder);
+    applyOrder(lodInterval, reorderOrder);
+    applyOrder(handleSlot, reorderOrder);
+    if (static_cast<int>(positionsPrevious.size()) == count)
+        applyOrder(positionsPrevious, reorderOrder);
+
+    for (int i = 0; i < count; ++i)
+        slots[handleSlot[i]].index = i;
+
+    // every cell list refers to old indices now
+    grid.needsRebuild = true;
+}
@@ -1,49 +1,324 @@
-
 #pragma once
 
 #include <SFML/Graphics.hpp>
-#include <unordered_map>
+#include <cstdint>
+#include <memory>
+#include <utility>
 #include <vector>
-#include "Particle.hpp"
+#include "ThreadPool.hpp"
+#include "TileGrid.hpp"
 
 /// <summary>
-/// Solver using spatial hash grid to resolve particle collisions efficiently.
+/// Solver using a uniform grid to resolve particle collisions efficiently.
+/// Particle state is stored as structure of arrays, one entry per particle in each array.
+/// The arrays are sorted along a Morton curve now and then so particles close in space are close in memory.
+/// An index addresses a particle until the next sort or removal, a handle for as long as the particle exists.
 /// </summary>
 class Solver {
 public:
-    // Spatial hash grid for quick collision lookup
-    struct SpatialHashGrid {
+    // Dense uniform grid covering the level bounds, built with a counting sort.
+    // Particles of cell c are cellParticles[cellStart[c] .. cellEnd(c)), the slots up to cellStart[c + 1]
+    // are free room for particles moving in.
+    // The arrays are reused between frames so rebuilding does not allocate.
+    // Between rebuilds only the particles that changed cell are moved.
+    struct UniformGrid {
         float cellSize;
-        std::unordered_map<long long, std::vector<int>> grid;
+        sf::Vector2f origin;
+        int cols = 0;
+        int rows = 0;
+        bool needsRebuild = true;
+
+        std::vector<int> cellStart;      // cols * rows + 1 offsets
+        std::vector<int> cellCount;      // particles in each cell
+        std::vector<int> cellParticles;  // particle indices sorted by cell, -1 in the free slots
+        std::vector<int> particleCell;   // cell index of each particle
+        std::vector<int> particleSlot;   // position of each particle in cellParticles
+
+        int movedLastUpdate = 0;         // particles relocated by the last update
+
+        UniformGrid(float cellSize_);
+
+        void resize(const sf::Vector2f& topLeft, const sf::Vector2f& size);
+        sf::Vector2i worldToCell(const sf::Vector2f& pos) const;
+        int cellIndex(const sf::Vector2f& pos) const;
+        void build(const std::vector<sf::Vector2f>& positions);
+        void update(const std::vector<sf::Vector2f>& positions);
+        int cellEnd(int cell) const { return cellStart[cell] + cellCount[cell]; }
+
+    private:
+        void relocate(int index, int from, int to);
+    };
+
+    // Collision pair counters, tested pairs had their distance measured and resolved ones overlapped
+    struct Stats {
+        long long pairsTested = 0;
+        long long pairsResolved = 0;
+    };
 
-        SpatialHashGrid(float cellSize_);
+    // Stable reference to one particle. The slot is reused after the particle is removed,
+    // the generation tells the new particle apart so old handles stop resolving.
+    struct ParticleHandle {
+        int slot = -1;
+        std::uint32_t generation = 0;
 
-        long long hash(int x, int y) const;
-        sf::Vector2i worldToCell(const sf::Vector2f& pos, const sf::Vector2f& rectTopLeft) const;
-        void insert(const sf::Vector2f& pos, int index, const sf::Vector2f& rectTopLeft);
-        void clear();
+        bool operator==(const ParticleHandle& other) const { return slot == other.slot && generation == other.generation; }
+        bool operator!=(const ParticleHandle& other) const { return !(*this == other); }
+    };
+
+    // Persistent radial force applied to the particles around it every physics step,
+    // positive strength pushes away and negative pulls in (pixels / s^2 at the centre)
+    struct ForceEmitter {
+        sf::Vector2f position;
+        float radius = 100.f;
+        float strength = 0.f;
+        int id = -1;
     };
 
     Solver();
 
-    // Add new particle
-    Particle& addObject(sf::Vector2f position, float radius);
+    // Add new particle, amortised O(1)
+    ParticleHandle addObject(sf::Vector2f position, float radius);
+
+    // Removes a particle in O(1), the last particle moves in to its index. Returns false for stale handles.
+    bool removeObject(ParticleHandle handle);
+
+    // Index of a particle in the arrays right now or -1 when the handle is stale,
+    // and the handle of the particle at an index
+    int getIndex(ParticleHandle handle) const;
+    ParticleHandle getHandle(int index) const;
+    bool isAlive(ParticleHandle handle) const;
+
+    // Morton reordering: the arrays are sorted every interval steps, or sooner once the disorder
+    // measured every few steps goes above the threshold (0..1). Zero turns the trigger off.
+    void setReorderInterval(int steps);
+    void setReorderThreshold(float disorder);
+    void reorder();
+
+    // Share of particles not stored right after the previous particle of the same grid cell
+    float measureDisorder() const;
+
+    // Remove all particles
+    void clear();
+
+    // Replaces every particle with the given ones at rest, copying each array in one go.
+    // Same as clear and an addObject per particle, without growing the arrays one by one.
+    void assignObjects(const std::vector<sf::Vector2f>& newPositions, const std::vector<float>& newRadii);
+
+    // Main update loop, runs as many fixed physics steps as the elapsed frame time owes
+    void update(const sf::RectangleShape& rect, float frameTime);
+
+    // One fixed physics step: gravity plus the collision substeps
+    void step(const sf::RectangleShape& rect);
+
+    // Collision substeps per physics step, they split the step in to equal parts.
+    // More substeps make the water stiffer and more stable, not faster.
+    void setSubsteps(int count);
+    int getSubsteps() const;
+
+    // Simulated time of one physics step, and how many steps one update may catch up at most.
+    // The substeps share this time, so a shorter step runs the physics more often at the same speed.
+    void setFixedTimestep(float seconds);
+    float getFixedTimestep() const;
+    void setMaxStepsPerUpdate(int count);
+
+    // How far the render time is between the last two physics steps, 0..1
+    float getInterpolationAlpha() const;
+
+    // Physics steps run since the solver was made
+    long long getStepCount() const;
+
+    // Solid map tiles the particles collide with, null for none. The grid has to outlive its use here.
+    void setTileGrid(const TileGrid* tileGrid);
 
-    // Main update loop
-    void update(const sf::RectangleShape& rect);
+    // Number of threads solving collisions, 1 solves everything on the calling thread
+    void setThreadCount(int count);
+    int getThreadCount() const;
 
-    // Draw spatial hash grid (for debug)
-    void drawGrid(const sf::RectangleShape& rect, sf::RenderWindow& window);
+    // Edge length of the collision grid cells
+    float getGridCellSize() const;
 
     // Access particles
-    std::vector<Particle>& getObjects();
+    int getObjectCount() const;
+    const std::vector<sf::Vector2f>& getPositions() const;
+    const std::vector<float>& getRadii() const;
+
+    // Positions before the latest physics step, rendering blends them with getInterpolationAlpha
+    const std::vector<sf::Vector2f>& getPreviousPositions() const;
+
+    // Per particle physics, changing the velocity wakes the particle up
+    void setVelocity(int index, sf::Vector2f v, float dt);
+    void addVelocity(int index, sf::Vector2f v, float dt);
+    sf::Vector2f getVelocity(int index) const;
+
+    // Spatial queries through the collision grid, only the cells under the area are visited.
+    // Indices of the particles found are appended to out.
+    void queryRadius(const sf::Vector2f& center, float radius, std::vector<int>& out) const;
+    void queryRect(const sf::FloatRect& area, std::vector<int>& out) const;
+
+    // Adds a velocity pointing away from center to every particle within radius that is not frozen,
+    // returns how many were pushed
+    int applyRadialImpulse(const sf::Vector2f& center, float radius, float strength, float dt);
+
+    // Force emitters live until removed, the returned id addresses them
+    int addForceEmitter(const sf::Vector2f& position, float radius, float strength);
+    void setForceEmitterPosition(int id, const sf::Vector2f& position);
+    void removeForceEmitter(int id);
+    void clearForceEmitters();
+
+    // Counters summed over all steps since the last reset
+    const Stats& getStats() const;
+    void resetStats();
+
+    // Sleeping: a particle that stays slower than sleepVelocity for sleepSteps physics steps stops being
+    // integrated and tested against other sleeping particles until something disturbs it
+    void setSleepingEnabled(bool enabled);
+    void setSleepThreshold(float velocity, int steps);
+    bool isSleeping(int index) const;
+    int getAwakeCount() const;
+    void wake(int index);
+    void wakeAll();
+
+    // Only the particles around the active area are simulated. The map is split in to square pages,
+    // pages touching the area run and the ring of pages around them is frozen: held asleep where they are,
+    // nothing wakes them and awake particles meet them like a wall. Pages further out are paged out of
+    // the solver arrays, only position and radius are kept, so a step costs the same on any map size.
+    // Handles of paged out particles go stale, they come back at rest with new ones.
+    void setActiveArea(const sf::FloatRect& area);
+    void clearActiveArea();     // pages every particle back in
+    int getFrozenCount() const;
+    int getPagedOutCount() const;
+
+    // Level of detail: the map is split in to square regions and the particles of a region only take
+    // part in every rate-th physics step, so the water there moves rate times slower. Regions touching
+    // the focus area run every step, the rate doubles per region further out up to the max rate,
+    // 0 means frozen. Without a focus area every particle runs every step.
+    void setFocusArea(const sf::FloatRect& area);
+    void clearFocusArea();
+    void setLodRegionSize(float size);
+    void setMaxLodRate(int rate);   // rounded down to a power of two
+    int getLodRegionCols() const;
+    int getLodRegionRows() const;
+    const std::vector<unsigned char>& getRegionRates() const;   // row by row, updated every step
+    int getIdleCount() const;       // particles left out of the current step
 
 private:
-    std::vector<Particle> objects;
-    SpatialHashGrid hashGrid{ 45.0f };
-    sf::Vector2f gravity{ 0.f, 800.f };
-    float step_dt{ 1.0f / 120.f };
+    std::vector<sf::Vector2f> positions;
+    std::vector<sf::Vector2f> positionsLast;
+    std::vector<sf::Vector2f> accelerations;
+    std::vector<float> radii;
+    std::vector<sf::Vector2f> positionsPrevious;  // positions before the latest physics step, for rendering
+    std::vector<unsigned char> sleeping;          // 1 when the particle sleeps, frozenFlag or idleFlag
+    std::vector<int> restingSteps;                // physics steps in a row below sleepVelocity
+    std::vector<float> motion;                    // smoothed squared speed
+    std::vector<unsigned char> lodWaited;         // steps skipped since last integrated
+    std::vector<unsigned char> lodInterval;       // steps the latest step stood in for
+    std::vector<int> handleSlot;                  // handle slot of each particle
+
+    // Handle slots, a free slot keeps its generation and waits in freeSlots
+    struct HandleSlot {
+        int index = -1;
+        std::uint32_t generation = 0;
+    };
+    std::vector<HandleSlot> slots;
+    std::vector<int> freeSlots;
+
+    UniformGrid grid{ 45.0f };
+    sf::Vector2f gravity{ 0.f, 600.f };
+    int substeps{ 3 };
+
+    // Time of one substep, fixed_dt / substeps. Velocity damping is tuned per substep at the defaults
+    // and rescaled from referenceSubstepDt so the water loses the same speed per second at any count.
+    static constexpr float referenceSubstepDt = (1.0f / 60.f) / 3;
+    float step_dt{ referenceSubstepDt };
+    float substepDamping{ 0.99f };
+    float substepScale{ 1.f };      // step_dt / referenceSubstepDt, distance per substep scales with it
+
+    // Fixed timestep, one step is what used to be one frame at 60 fps
+    float fixed_dt{ 1.0f / 60.f };
+    float accumulator{ 0.f };
+    int maxStepsPerUpdate{ 5 };
+    long long stepCount{ 0 };
+
+    // Sleeping
+    bool sleepingEnabled{ true };
+    float sleepVelocity{ 0.15f };   // pixels per substep at referenceSubstepDt
+    int sleepSteps{ 60 };
+    float wakeVelocity{ 2.0f };     // a neighbour moving faster than this wakes a sleeper it touches, same unit
+    sf::FloatRect lastBounds;
+    std::vector<int> cellAwake;     // awake particles per grid cell
+    std::vector<int> cellCountLast; // particles per grid cell after the previous step
+    std::vector<unsigned char> cellStirred; // cells that lost particles during the step
+    sf::Vector2f cellCountOrigin;   // grid origin cellCountLast was counted with
+    int supportProbeSteps{ 10 };    // steps a sleeper woken by a lost support has to start falling
+
+    // Active area, the pages are checked at the start of every step
+    static constexpr unsigned char frozenFlag = 2;
+    bool activeAreaSet{ false };
+    sf::FloatRect activeArea;
+
+    enum class PageState : unsigned char { Out, Frozen, Active };
+    struct Page {
+        PageState state = PageState::Active;
+        std::vector<sf::Vector2f> positions;    // paged out particles
+        std::vector<float> radii;
+    };
+    float pageSize{ 320.f };
+    int pageCols{ 0 };
+    int pageRows{ 0 };
+    std::vector<Page> pages;        // row by row over the map bounds
+    int pagedOutCount{ 0 };
+    bool pagesDirty{ true };        // area or bounds changed since the page states were worked out
+    sf::FloatRect residentArea;     // pages that are not paged out, the grid only covers these
+
+    // Level of detail, idleFlag marks particles waiting for the next step of their region
+    static constexpr unsigned char idleFlag = 3;
+    bool focusAreaSet{ false };
+    sf::FloatRect focusArea;
+    float lodRegionSize{ 320.f };
+    int maxLodRate{ 4 };
+    int regionCols{ 0 };
+    int regionRows{ 0 };
+    std::vector<unsigned char> regionRates;
+
+    const TileGrid* tiles = nullptr;
+
+    std::vector<ForceEmitter> emitters;
+    int nextEmitterId = 0;
+    std::vector<int> queryResults;  // reused by the emitters
+
+    // Morton reordering
+    int reorderInterval{ 300 };
+    float reorderThreshold{ 0.5f };
+    int disorderCheckSteps{ 30 };
+    int stepsSinceReorder{ 0 };
+    std::vector<std::pair<std::uint32_t, int>> reorderKeys;
+    std::vector<int> reorderOrder;
+
+    std::unique_ptr<ThreadPool> pool;
+
+    Stats stats;
+    std::vector<Stats> rowStats;    // one per grid row of a colour, summed after the rows are solved
 
+    void updateSubstepTime();
     void applyGravity();
-    void checkCollisionsSpatial(const sf::RectangleShape& rect);
+    void applyForceEmitters();
+    void updateObjects(const sf::RectangleShape& rect, float dt);
+    void checkCollisionsSpatial();
+    void solveCell(int cx, int cy, Stats& cellStats);
+    void solveTileCollisions();
+    void solveTileCollisions(int begin, int end);
+    void countAwakePerCell();
+    bool isQuietNeighbourhood(int cx, int cy) const;
+    void wakeUnsupported();
+    void updateSleeping();
+    void removeAt(int index);
+    int pageOf(const sf::Vector2f& position) const;
+    void updatePageStates();
+    void updatePages();
+    void pageAllIn();
+    void updateRegionRates();
+    int regionOf(const sf::Vector2f& position) const;
+    void updateLod();
+    void finishLod();
+    void maybeReorder();
 };
@@ -0,0 +1,209 @@
+// SolverThread.cpp
+#include "SolverThread.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+
+SolverThread::SolverThread(Solver& solver_) : solver(solver_) {}
+
+SolverThread::~SolverThread() {
+    stop();
+}
+
+void SolverThread::start(const sf::RectangleShape& bounds_) {
+    if (isRunning()) return;
+
+    bounds = bounds_;
+
+    // the render thread sees the current state until the first step is done
+    for (Snapshot& snapshot : buffers)
+        snapshot = Snapshot();
+    back = 0;
+    front = 1;
+    middle.store(2, std::memory_order_relaxed);
+    publish(solver.getStepCount());
+
+    running.store(true, std::memory_order_release);
+    thread = std::thread(&SolverThread::run, this);
+}
+
+// emitters made through commands only make sense while the thread runs
+void SolverThread::stop() {
+    if (!thread.joinable()) return;
+
+    running.store(false, std::memory_order_release);
+    thread.join();
+
+    Impulse impulse;
+    while (impulses.pop(impulse)) {}
+    impulseBacklog.clear();
+    {
+        std::lock_guard<std::mutex> lock(latestMutex);
+        latest = Latest();
+    }
+    for (const auto& emitter : emitterIds)
+        solver.removeForceEmitter(emitter.second);
+    emitterIds.clear();
+}
+
+bool SolverThread::isRunning() const {
+    return running.load(std::memory_order_acquire);
+}
+
+// called with latestMutex held
+SolverThread::EmitterState& SolverThread::latestEmitter(int key) {
+    for (EmitterState& emitter : latest.emitters) {
+        if (emitter.key == key)
+            return emitter;
+    }
+    latest.emitters.push_back(EmitterState());
+    latest.emitters.back().key = key;
+    return latest.emitters.back();
+}
+
+void SolverThread::setEmitter(int key, const sf::Vector2f& position, float radius, float strength) {
+    pushImpulses();
+    std::lock_guard<std::mutex> lock(latestMutex);
+    EmitterState& emitter = latestEmitter(key);
+    emitter.position = position;
+    emitter.radius = radius;
+    emitter.strength = strength;
+    emitter.active = true;
+}
+
+void SolverThread::removeEmitter(int key) {
+    pushImpulses();
+    std::lock_guard<std::mutex> lock(latestMutex);
+    latestEmitter(key).active = false;
+}
+
+void SolverThread::applyRadialImpulse(const sf::Vector2f& center, float radius, float strength, float dt) {
+    Impulse impulse;
+    impulse.center = center;
+    impulse.radius = radius;
+    impulse.strength = strength;
+    impulse.dt = dt;
+    impulseBacklog.push_back(impulse);
+    pushImpulses();
+}
+
+void SolverThread::setActiveArea(const sf::FloatRect& area) {
+    pushImpulses();
+    std::lock_guard<std::mutex> lock(latestMutex);
+    latest.activeAreaSet = true;
+    latest.activeArea = area;
+}
+
+void SolverThread::setFocusArea(const sf::FloatRect& area) {
+    pushImpulses();
+    std::lock_guard<std::mutex> lock(latestMutex);
+    latest.focusAreaSet = true;
+    latest.focusArea = area;
+}
+
+// impulses that did not fit stay in order in the backlog, every later call tries them again
+void SolverThread::pushImpulses() {
+    size_t pushed = 0;
+    while (pushed < impulseBacklog.size() && impulses.push(impulseBacklog[pushed]))
+        ++pushed;
+    impulseBacklog.erase(impulseBacklog.begin(), impulseBacklog.begin() + pushed);
+}
+
+void SolverThread::applyCommands() {
+    // take the latest values and leave the slots empty, removed emitters are forgotten once taken
+    {
+        std::lock_guard<std::mutex> lock(latestMutex);
+        taken.emitters.assign(latest.emitters.begin(), latest.emitters.end());
+        taken.activeAreaSet = latest.activeAreaSet;
+        taken.activeArea = latest.activeArea;
+        taken.focusAreaSet = latest.focusAreaSet;
+        taken.focusArea = latest.focusArea;
+
+        latest.emitters.erase(std::remove_if(latest.emitters.begin(), latest.emitters.end(),
+            [](const EmitterState& emitter) { return !emitter.active; }), latest.emitters.end());
+        latest.activeAreaSet = false;
+        latest.focusAreaSet = false;
+    }
+
+    for (const EmitterState& emitter : taken.emitters) {
+        auto found = std::find_if(emitterIds.begin(), emitterIds.end(),
+            [&](const std::pair<int, int>& id) { return id.first == emitter.key; });
+
+        if (!emitter.active) {
+            if (found != emitterIds.end()) {
+                solver.removeForceEmitter(found->second);
+                emitterIds.erase(found);
+            }
+        }
+        else if (found == emitterIds.end())
+            emitterIds.push_back({ emitter.key, solver.addForceEmitter(emitter.position, emitter.radius, emitter.strength) });
+        else
+            solver.setForceEmitterPosition(found->second, emitter.position);
+    }
+
+    if (taken.activeAreaSet)
+        solver.setActiveArea(taken.activeArea);
+    if (taken.focusAreaSet)
+        solver.setFocusArea(taken.focusArea);
+
+    Impulse impulse;
+    while (impulses.pop(impulse))
+        solver.applyRadialImpulse(impulse.center, impulse.radius, impulse.strength, impulse.dt);
+}
+
+// runs the solver against the real clock and sleeps until the next step is due
+void SolverThread::run() {
+    Trace::setThreadName("physics");
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point last = Clock::now();
+    long long publishedStep = solver.getStepCount();
+
+    while (running.load(std::memory_order_acquire)) {
+        applyCommands();
+
+        Clock::time_point now = Clock::now();
+        float elapsed = std::chrono::duration<float>(now - last).count();
+        last = now;
+
+        solver.update(bounds, elapsed);
+
+        if (solver.getStepCount() != publishedStep) {
+            publishedStep = solver.getStepCount();
+            publish(publishedStep);
+        }
+
+        float untilNext = (1.f - solver.getInterpolationAlpha()) * solver.getFixedTimestep();
+        std::this_thread::sleep_until(now + std::chrono::duration<float>(std::max(untilNext, 0.f)));
+    }
+}
+
+void SolverThread::publish(long long step) {
+    TRACE_ZONE("SolverThread::publish");
+    Snapshot& snapshot = buffers[back];
+
+    const auto& positions = solver.getPositions();
+    const auto& previous = solver.getPreviousPositions();
+    snapshot.positions.assign(positions.begin(), positions.end());
+    if (previous.size() == positions.size())
+        snapshot.previous.assign(previous.begin(), previous.end());
+    else
+        snapshot.previous.assign(positions.begin(), positions.end());
+    snapshot.radii.assign(solver.getRadii().begin(), solver.getRadii().end());
+    snapshot.step = step;
+    snapshot.alpha = solver.getInterpolationAlpha();
+    snapshot.published = std::chrono::steady_clock::now();
+
+    back = middle.exchange(back | FreshBit, std::memory_order_acq_rel) & ~FreshBit;
+}
+
+const SolverThread::Snapshot& SolverThread::acquireLatest() {
+    if (middle.load(std::memory_order_acquire) & FreshBit)
+        front = middle.exchange(front, std::memory_order_acq_rel) & ~FreshBit;
+    return buffers[front];
+}
+
+// time since publishing carries the blend on until the next snapshot arrives
+float SolverThread::getInterpolationAlpha(const Snapshot& snapshot) const {
+    float since = std::chrono::duration<float>(std::chrono::steady_clock::now() - snapshot.published).count();
+    return std::min(snapshot.alpha + since / solver.getFixedTimestep(), 1.f);
+}
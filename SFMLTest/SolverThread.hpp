@@ -0,0 +1,109 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "Solver.hpp"
+#include "SpscQueue.hpp"
+
+/// <summary>
+/// Runs a Solver on its own thread in real time while the render loop keeps going.
+/// Every physics step is published as a snapshot through a triple buffer, the render thread always
+/// reads the newest complete one. Impulses reach the physics thread through a lock-free queue, emitters and
+/// areas through slots that only keep the latest value.
+/// While running, the solver belongs to the physics thread and must not be touched from outside.
+/// </summary>
+class SolverThread {
+public:
+    // Particle state after one physics step, interpolation blends previous to positions
+    struct Snapshot {
+        std::vector<sf::Vector2f> positions;
+        std::vector<sf::Vector2f> previous;
+        std::vector<float> radii;
+        long long step = 0;
+        float alpha = 0.f;  // interpolation alpha of the solver when published
+        std::chrono::steady_clock::time_point published;
+    };
+
+    explicit SolverThread(Solver& solver);
+    ~SolverThread();
+
+    SolverThread(const SolverThread&) = delete;
+    SolverThread& operator=(const SolverThread&) = delete;
+
+    // bounds are copied, the level must not change until stop
+    void start(const sf::RectangleShape& bounds);
+    void stop();
+    bool isRunning() const;
+
+    // Applied on the physics thread before its next update. Impulses are queued and never dropped, an
+    // emitter or area set again before the physics thread got to it only keeps its latest value.
+    // Emitters are named by the caller, setEmitter creates the emitter the first time.
+    void setEmitter(int key, const sf::Vector2f& position, float radius, float strength);
+    void removeEmitter(int key);
+    void applyRadialImpulse(const sf::Vector2f& center, float radius, float strength, float dt);
+    void setActiveArea(const sf::FloatRect& area);
+    void setFocusArea(const sf::FloatRect& area);
+
+    // Newest published snapshot, stays valid until the next call
+    const Snapshot& acquireLatest();
+
+    // Interpolation alpha for drawing a snapshot now
+    float getInterpolationAlpha(const Snapshot& snapshot) const;
+
+private:
+    struct Impulse {
+        sf::Vector2f center;
+        float radius = 0.f;
+        float strength = 0.f;
+        float dt = 0.f;
+    };
+
+    struct EmitterState {
+        int key = 0;
+        sf::Vector2f position;
+        float radius = 0.f;
+        float strength = 0.f;
+        bool active = true;     // false once removed, the entry goes when the physics thread saw it
+    };
+
+    // Values the render thread set since the physics thread last looked
+    struct Latest {
+        std::vector<EmitterState> emitters;
+        bool activeAreaSet = false;
+        sf::FloatRect activeArea;
+        bool focusAreaSet = false;
+        sf::FloatRect focusArea;
+    };
+
+    Solver& solver;
+    sf::RectangleShape bounds;
+    std::thread thread;
+    std::atomic<bool> running{ false };
+
+    SpscQueue<Impulse, 256> impulses;
+    std::vector<Impulse> impulseBacklog;            // render thread only, waits for room in the queue
+
+    std::mutex latestMutex;
+    Latest latest;                                  // guarded by latestMutex
+    Latest taken;                                   // physics thread copy of latest
+    std::vector<std::pair<int, int>> emitterIds;   // caller key, solver emitter id
+
+    // triple buffer: the physics thread owns back, the render thread owns front and
+    // middle holds the newest snapshot plus a fresh bit
+    static constexpr int FreshBit = 4;
+    Snapshot buffers[3];
+    int back = 0;
+    int front = 1;
+    std::atomic<int> middle{ 2 };
+
+    void run();
+    void pushImpulses();
+    EmitterState& latestEmitter(int key);
+    void applyCommands();
+    void publish(long long step);
+};
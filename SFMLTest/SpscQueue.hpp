@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+/// <summary>
+/// Fixed size queue for exactly one producer thread and one consumer thread, no locks.
+/// Capacity must be a power of two, one slot is always left empty.
+/// </summary>
+template <typename T, std::size_t Capacity>
+class SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    // Producer only, returns false when the queue is full
+    bool push(const T& value) {
+        std::size_t tail = writeIndex.load(std::memory_order_relaxed);
+        std::size_t next = (tail + 1) & (Capacity - 1);
+        if (next == readIndex.load(std::memory_order_acquire))
+            return false;
+
+        items[tail] = value;
+        writeIndex.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only, returns false when the queue is empty
+    bool pop(T& value) {
+        std::size_t head = readIndex.load(std::memory_order_relaxed);
+        if (head == writeIndex.load(std::memory_order_acquire))
+            return false;
+
+        value = items[head];
+        readIndex.store((head + 1) & (Capacity - 1), std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::array<T, Capacity> items{};
+    alignas(64) std::atomic<std::size_t> writeIndex{ 0 };
+    alignas(64) std::atomic<std::size_t> readIndex{ 0 };
+};
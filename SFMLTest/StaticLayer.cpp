@@ -0,0 +1,202 @@
+// StaticLayer.cpp
+#include "StaticLayer.hpp"
+#include <algorithm>
+#include <utility>
+#include <cmath>
+
+// two triangles covering the rectangle
+void StaticLayer::appendRect(sf::VertexArray& vertices, const sf::Vector2f& topLeft, const sf::Vector2f& size, const sf::Color& color) {
+    sf::Vector2f topRight(topLeft.x + size.x, topLeft.y);
+    sf::Vector2f bottomRight = topLeft + size;
+    sf::Vector2f bottomLeft(topLeft.x, topLeft.y + size.y);
+
+    vertices.append(sf::Vertex{ topLeft, color, {} });
+    vertices.append(sf::Vertex{ topRight, color, {} });
+    vertices.append(sf::Vertex{ bottomRight, color, {} });
+    vertices.append(sf::Vertex{ topLeft, color, {} });
+    vertices.append(sf::Vertex{ bottomRight, color, {} });
+    vertices.append(sf::Vertex{ bottomLeft, color, {} });
+}
+
+void StaticLayer::build(const TileGrid& tiles, float gridCellSize_) {
+    clear();
+
+    origin = tiles.getOrigin();
+    gridCellSize = gridCellSize_;
+    chunkSize = chunkTiles * tiles.getTileSize();
+    chunkCols = (tiles.getCols() + chunkTiles - 1) / chunkTiles;
+    chunkRows = (tiles.getRows() + chunkTiles - 1) / chunkTiles;
+
+    // same cells the solver grid uses, whole cells over the map
+    sf::Vector2f mapSize(tiles.getCols() * tiles.getTileSize(), tiles.getRows() * tiles.getTileSize());
+    gridSize = {
+        std::ceil(mapSize.x / gridCellSize) * gridCellSize,
+        std::ceil(mapSize.y / gridCellSize) * gridCellSize
+    };
+
+    chunks.resize(static_cast<size_t>(chunkCols) * chunkRows);
+    for (int cy = 0; cy < chunkRows; ++cy) {
+        for (int cx = 0; cx < chunkCols; ++cx) {
+            // chunks on the far edges also take the map remainder and the overlay past the map
+            sf::Vector2f topLeft = origin + sf::Vector2f(cx * chunkSize, cy * chunkSize);
+            sf::Vector2f bottomRight = topLeft + sf::Vector2f(chunkSize, chunkSize);
+            if (cx == chunkCols - 1) bottomRight.x = origin.x + std::max(mapSize.x, gridSize.x);
+            if (cy == chunkRows - 1) bottomRight.y = origin.y + std::max(mapSize.y, gridSize.y);
+
+            chunks[static_cast<size_t>(cy) * chunkCols + cx].area = sf::FloatRect(topLeft, bottomRight - topLeft);
+        }
+    }
+}
+
+void StaticLayer::clear() {
+    chunks.clear();
+    residentChunks.clear();
+    chunkCols = 0;
+    chunkRows = 0;
+}
+
+void StaticLayer::updateResidency(const sf::FloatRect& area, const TileGrid& tiles) {
+    if (chunks.empty()) return;
+
+    int col0 = std::max(static_cast<int>(std::floor((area.position.x - origin.x) / chunkSize)), 0);
+    int row0 = std::max(static_cast<int>(std::floor((area.position.y - origin.y) / chunkSize)), 0);
+    int col1 = std::min(static_cast<int>(std::floor((area.position.x + area.size.x - origin.x) / chunkSize)), chunkCols - 1);
+    int row1 = std::min(static_cast<int>(std::floor((area.position.y + area.size.y - origin.y) / chunkSize)), chunkRows - 1);
+
+    auto wanted = [&](int index) {
+        int cx = index % chunkCols;
+        int cy = index / chunkCols;
+        return cx >= col0 && cx <= col1 && cy >= row0 && cy <= row1;
+    };
+
+    // the camera moves little per frame, usually nothing changes here
+    for (int index : residentChunks) {
+        if (!wanted(index))
+            pageOut(chunks[index]);
+    }
+    residentChunks.erase(std::remove_if(residentChunks.begin(), residentChunks.end(),
+        [this](int index) { return !chunks[index].resident; }), residentChunks.end());
+
+    for (int cy = row0; cy <= row1; ++cy) {
+        for (int cx = col0; cx <= col1; ++cx) {
+            int index = cy * chunkCols + cx;
+            if (chunks[index].resident) continue;
+
+            bake(index, tiles);
+            residentChunks.push_back(index);
+        }
+    }
+}
+
+void StaticLayer::bake(int index, const TileGrid& tiles) {
+    Chunk& chunk = chunks[index];
+    const float tileSize = tiles.getTileSize();
+    const sf::FloatRect& area = chunk.area;
+    sf::Vector2f areaEnd = area.position + area.size;
+
+    int col0 = static_cast<int>(std::lround((area.position.x - origin.x) / tileSize));
+    int row0 = static_cast<int>(std::lround((area.position.y - origin.y) / tileSize));
+    int col1 = std::min(col0 + chunkTiles, tiles.getCols());
+    int row1 = std::min(row0 + chunkTiles, tiles.getRows());
+
+    for (int row = row0; row < row1; ++row) {
+        for (int col = col0; col < col1; ++col) {
+            if (tiles.isSolid(row, col))
+                appendRect(chunk.walls, tiles.getTileRect(row, col).position, { tileSize, tileSize }, sf::Color::Blue);
+        }
+    }
+
+    // one pixel lines on the cell borders, a line belongs to the chunk it starts in and
+    // the closing lines on the far edges to the last chunks
+    const sf::Color lineColor(60, 60, 60, 120);
+    int gridCols = static_cast<int>(std::lround(gridSize.x / gridCellSize));
+    int gridRows = static_cast<int>(std::lround(gridSize.y / gridCellSize));
+    bool lastCol = (index % chunkCols) == chunkCols - 1;
+    bool lastRow = (index / chunkCols) == chunkRows - 1;
+
+    float top = area.position.y;
+    float bottom = std::min(areaEnd.y, origin.y + gridSize.y);
+    float left = area.position.x;
+    float right = std::min(areaEnd.x, origin.x + gridSize.x);
+
+    for (int k = static_cast<int>(std::ceil((left - origin.x) / gridCellSize)); k <= gridCols; ++k) {
+        float x = origin.x + k * gridCellSize;
+        if (x >= areaEnd.x && !lastCol) break;
+        appendRect(chunk.grid, { x - 0.5f, top }, { 1.f, bottom - top }, lineColor);
+    }
+    for (int k = static_cast<int>(std::ceil((top - origin.y) / gridCellSize)); k <= gridRows; ++k) {
+        float y = origin.y + k * gridCellSize;
+        if (y >= areaEnd.y && !lastRow) break;
+        appendRect(chunk.grid, { left, y - 0.5f }, { right - left, 1.f }, lineColor);
+    }
+
+    chunk.resident = true;
+}
+
+// a fresh array gives the memory back, clear would keep it
+void StaticLayer::pageOut(Chunk& chunk) {
+    chunk.walls = sf::VertexArray(sf::PrimitiveType::Triangles);
+    chunk.grid = sf::VertexArray(sf::PrimitiveType::Triangles);
+    chunk.resident = false;
+}
+
+void StaticLayer::swapGeometry(StaticLayer& other) {
+    std::swap(chunks, other.chunks);
+    std::swap(residentChunks, other.residentChunks);
+    std::swap(chunkCols, other.chunkCols);
+    std::swap(chunkRows, other.chunkRows);
+    std::swap(origin, other.origin);
+    std::swap(chunkSize, other.chunkSize);
+    std::swap(gridCellSize, other.gridCellSize);
+    std::swap(gridSize, other.gridSize);
+}
+
+void StaticLayer::copyGeometry(const StaticLayer& other) {
+    chunks = other.chunks;
+    residentChunks = other.residentChunks;
+    chunkCols = other.chunkCols;
+    chunkRows = other.chunkRows;
+    origin = other.origin;
+    chunkSize = other.chunkSize;
+    gridCellSize = other.gridCellSize;
+    gridSize = other.gridSize;
+}
+
+bool StaticLayer::isInView(const Chunk& chunk, const sf::RenderTarget& target) const {
+    const sf::View& view = target.getView();
+    sf::Vector2f viewTopLeft = view.getCenter() - view.getSize() / 2.f;
+    sf::Vector2f viewBottomRight = viewTopLeft + view.getSize();
+    sf::Vector2f chunkBottomRight = chunk.area.position + chunk.area.size;
+
+    // lines sit half a pixel outside the chunk edges
+    return chunk.area.position.x - 1.f < viewBottomRight.x && chunkBottomRight.x + 1.f > viewTopLeft.x &&
+        chunk.area.position.y - 1.f < viewBottomRight.y && chunkBottomRight.y + 1.f > viewTopLeft.y;
+}
+
+void StaticLayer::drawWalls(sf::RenderTarget& target) const {
+    for (int index : residentChunks) {
+        const Chunk& chunk = chunks[index];
+        if (chunk.walls.getVertexCount() > 0 && isInView(chunk, target))
+            target.draw(chunk.walls);
+    }
+}
+
+void StaticLayer::drawGrid(sf::RenderTarget& target) const {
+    if (!gridVisible) return;
+
+    for (int index : residentChunks) {
+        const Chunk& chunk = chunks[index];
+        if (chunk.grid.getVertexCount() > 0 && isInView(chunk, target))
+            target.draw(chunk.grid);
+    }
+}
+
+void StaticLayer::setGridVisible(bool visible) { gridVisible = visible; }
+
+void StaticLayer::toggleGrid() { gridVisible = !gridVisible; }
+
+bool StaticLayer::isGridVisible() const { return gridVisible; }
+
+int StaticLayer::getChunkCount() const { return static_cast<int>(chunks.size()); }
+
+int StaticLayer::getResidentCount() const { return static_cast<int>(residentChunks.size()); }
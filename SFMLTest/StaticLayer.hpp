@@ -0,0 +1,65 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include "TileGrid.hpp"
+
+/// <summary>
+/// Geometry that does not change while a level is played: walls and the debug grid overlay.
+/// The map is split in to square chunks and only chunks near the camera are resident, baked in to
+/// vertex arrays that draw in one call each. A chunk that is paged out keeps nothing, it is baked
+/// again from the one byte per tile TileGrid when the camera comes back.
+/// </summary>
+class StaticLayer {
+public:
+    // Edge length of a chunk in tiles
+    static constexpr int chunkTiles = 16;
+
+    // Splits the area of the tile grid in to chunks, nothing is baked until a chunk becomes resident
+    void build(const TileGrid& tiles, float gridCellSize);
+    void clear();
+
+    // Bakes the chunks overlapping area that are not resident yet and pages out all others
+    void updateResidency(const sf::FloatRect& area, const TileGrid& tiles);
+
+    // Exchanges or copies the chunks with other, the grid visibility stays as it is
+    void swapGeometry(StaticLayer& other);
+    void copyGeometry(const StaticLayer& other);
+
+    // Draw the resident chunks inside the current view of the target
+    void drawWalls(sf::RenderTarget& target) const;
+
+    // Draws the grid overlay only while it is switched on
+    void drawGrid(sf::RenderTarget& target) const;
+
+    void setGridVisible(bool visible);
+    void toggleGrid();
+    bool isGridVisible() const;
+
+    int getChunkCount() const;
+    int getResidentCount() const;
+
+private:
+    struct Chunk {
+        sf::VertexArray walls{ sf::PrimitiveType::Triangles };
+        sf::VertexArray grid{ sf::PrimitiveType::Triangles };
+        sf::FloatRect area;
+        bool resident = false;
+    };
+
+    std::vector<Chunk> chunks;
+    std::vector<int> residentChunks;
+    int chunkCols = 0;
+    int chunkRows = 0;
+    sf::Vector2f origin;
+    float chunkSize = 0.f;
+    float gridCellSize = 45.f;
+    sf::Vector2f gridSize;          // the overlay covers whole grid cells, it can reach past the map
+    bool gridVisible = true;
+
+    void bake(int index, const TileGrid& tiles);
+    void pageOut(Chunk& chunk);
+    bool isInView(const Chunk& chunk, const sf::RenderTarget& target) const;
+
+    static void appendRect(sf::VertexArray& vertices, const sf::Vector2f& topLeft, const sf::Vector2f& size, const sf::Color& color);
+};
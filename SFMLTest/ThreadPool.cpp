@@ -0,0 +1,80 @@
+#include "ThreadPool.hpp"
+#include "Trace.hpp"
+#include <string>
+
+ThreadPool::ThreadPool(int threadCount) {
+    for (int i = 1; i < threadCount; ++i)
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+int ThreadPool::getThreadCount() const {
+    return static_cast<int>(workers.size()) + 1;
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)>& task) {
+    if (count <= 0) return;
+
+    // not worth waking the workers for a single index
+    if (workers.empty() || count == 1) {
+        for (int i = 0; i < count; ++i)
+            task(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        currentTask = &task;
+        taskCount = count;
+        nextIndex.store(0, std::memory_order_relaxed);
+        busyWorkers = static_cast<int>(workers.size());
+        ++generation;
+    }
+    wakeCondition.notify_all();
+
+    runTasks();
+
+    // every worker has to check in before the next job may start
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCondition.wait(lock, [this] { return busyWorkers == 0; });
+    currentTask = nullptr;
+}
+
+// grabs indices until the job runs out
+void ThreadPool::runTasks() {
+    TRACE_ZONE("ThreadPool::runTasks");
+    for (int i = nextIndex.fetch_add(1); i < taskCount; i = nextIndex.fetch_add(1))
+        (*currentTask)(i);
+}
+
+void ThreadPool::workerLoop(int index) {
+    Trace::setThreadName(("pool worker " + std::to_string(index)).c_str());
+    unsigned seenGeneration = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeCondition.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = generation;
+        }
+
+        runTasks();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busyWorkers == 0)
+                doneCondition.notify_one();
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Fixed set of worker threads running index based jobs.
+/// The calling thread works on the job too and parallelFor returns when every index is done.
+/// </summary>
+class ThreadPool {
+public:
+    // threadCount includes the calling thread, so 4 starts 3 workers
+    explicit ThreadPool(int threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int getThreadCount() const;
+
+    // Runs task(i) for every i in [0, count) spread over all threads
+    void parallelFor(int count, const std::function<void(int)>& task);
+
+private:
+    void workerLoop(int index);
+    void runTasks();
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable doneCondition;
+
+    const std::function<void(int)>* currentTask = nullptr;
+    int taskCount = 0;
+    std::atomic<int> nextIndex{ 0 };
+    int busyWorkers = 0;
+    unsigned generation = 0;
+    bool stopping = false;
+};
@@ -0,0 +1,53 @@
+#include "TileGrid.hpp"
+#include <cmath>
+
+void TileGrid::build(const TileMap& map, const sf::Vector2f& topLeft, float tileSize_)
+{
+    rows = map.getRows();
+    cols = map.getCols();
+    tileSize = tileSize_;
+    origin = topLeft;
+
+    // both buffers are row-major with the same layout, so one pass copies the map.
+    // resize keeps the old capacity, reloading a level does not allocate
+    size_t count = static_cast<size_t>(rows) * cols;
+    solid.resize(count);
+    const char* tiles = map.data();
+    for (size_t i = 0; i < count; ++i)
+        solid[i] = tiles[i] == 'x';
+}
+
+void TileGrid::clear()
+{
+    solid.clear();
+    rows = 0;
+    cols = 0;
+}
+
+bool TileGrid::isSolid(int row, int col) const
+{
+    if (row < 0 || col < 0 || row >= rows || col >= cols)
+        return false;
+    return solid[static_cast<size_t>(row) * cols + col] != 0;
+}
+
+sf::Vector2i TileGrid::worldToTile(const sf::Vector2f& pos) const
+{
+    sf::Vector2f relativePos = pos - origin;
+    return { (int)std::floor(relativePos.x / tileSize), (int)std::floor(relativePos.y / tileSize) };
+}
+
+sf::FloatRect TileGrid::getTileRect(int row, int col) const
+{
+    return { origin + sf::Vector2f(col * tileSize, row * tileSize), { tileSize, tileSize } };
+}
+
+int TileGrid::getRows() const { return rows; }
+
+int TileGrid::getCols() const { return cols; }
+
+float TileGrid::getTileSize() const { return tileSize; }
+
+const sf::Vector2f& TileGrid::getOrigin() const { return origin; }
+
+bool TileGrid::empty() const { return solid.empty(); }
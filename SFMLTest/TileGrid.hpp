@@ -0,0 +1,35 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <vector>
+#include "TileMap.hpp"
+
+/// <summary>
+/// Solid tile occupancy of the level map, one byte per tile in row-major order.
+/// Lets anything find the walls around a point by index math instead of looping over every wall.
+/// </summary>
+class TileGrid {
+public:
+    // Marks every 'x' of the map as solid, topLeft is the world position of tile (0, 0)
+    void build(const TileMap& map, const sf::Vector2f& topLeft, float tileSize);
+    void clear();
+
+    // Tiles outside the map are never solid, the level bounds handle those
+    bool isSolid(int row, int col) const;
+
+    sf::Vector2i worldToTile(const sf::Vector2f& pos) const;   // x = col, y = row
+    sf::FloatRect getTileRect(int row, int col) const;
+
+    int getRows() const;
+    int getCols() const;
+    float getTileSize() const;
+    const sf::Vector2f& getOrigin() const;
+    bool empty() const;
+
+private:
+    std::vector<unsigned char> solid;
+    int rows = 0;
+    int cols = 0;
+    float tileSize = 20.f;
+    sf::Vector2f origin;
+};
@@ -0,0 +1,241 @@
+#include "TileMap.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+
+#if defined(_WIN32)
+#define TILEMAP_MMAP
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#define TILEMAP_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Fed the file in pieces of any size, a line may be split over two pieces.
+// Characters go straight in to the map buffer, a row is checked when its line ends.
+class TileMapParser {
+public:
+    // sizeHint is the byte size of the whole text when known, the buffer is reserved for it once
+    TileMapParser(TileMap& map_, std::string& error_, std::size_t sizeHint = 0) : map(map_), error(error_)
+    {
+        map.clear();
+        map.tiles.reserve(sizeHint);
+    }
+
+    bool feed(const char* data, std::size_t size)
+    {
+        const char* end = data + size;
+        while (data < end && !failed) {
+            const char* newline = static_cast<const char*>(std::memchr(data, '\n', end - data));
+            const char* lineEnd = newline ? newline : end;
+
+            std::size_t length = lineEnd - data;
+            if (width + length > static_cast<std::size_t>(INT_MAX))
+                return fail("line " + std::to_string(line) + " is too long");
+
+            map.tiles.insert(map.tiles.end(), data, lineEnd);
+            width += length;
+
+            if (!newline) break;
+            endRow();
+            data = newline + 1;
+        }
+        return !failed;
+    }
+
+    bool finish()
+    {
+        if (failed) return false;
+
+        // last line without a newline
+        if (width > 0) endRow();
+        if (failed) return false;
+
+        if (map.rows == 0)
+            return fail("map is empty");
+        return true;
+    }
+
+private:
+    TileMap& map;
+    std::string& error;
+    std::size_t width = 0;   // characters of the current line so far
+    int line = 1;
+    int blankLines = 0;      // blank lines seen since the last row
+    bool failed = false;
+
+    bool fail(const std::string& message)
+    {
+        error = message;
+        failed = true;
+        map.clear();
+        return false;
+    }
+
+    void endRow()
+    {
+        // windows line ending
+        if (width > 0 && map.tiles.back() == '\r') {
+            map.tiles.pop_back();
+            --width;
+        }
+
+        // blank lines are fine at the end of the file, anywhere else they would be a row of nothing
+        if (width == 0) {
+            ++blankLines;
+            ++line;
+            return;
+        }
+        if (blankLines > 0) {
+            fail("line " + std::to_string(line - blankLines) + " is empty");
+            return;
+        }
+
+        if (map.rows == 0) {
+            map.cols = static_cast<int>(width);
+        }
+        else if (width != static_cast<std::size_t>(map.cols)) {
+            fail("line " + std::to_string(line) + " has " + std::to_string(width) +
+                " tiles, expected " + std::to_string(map.cols));
+            return;
+        }
+        if (map.rows == INT_MAX) {
+            fail("too many rows");
+            return;
+        }
+
+        ++map.rows;
+        ++line;
+        width = 0;
+    }
+};
+
+namespace {
+
+#ifdef TILEMAP_MMAP
+    // Parses the whole file mapped read only, returns false when it could not be mapped (empty file,
+    // address space) and the caller should stream it instead. Sets opened when the file exists.
+    bool parseMapped(const std::string& path, TileMap& map, std::string& error, bool& opened)
+    {
+#if defined(_WIN32)
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        opened = file != INVALID_HANDLE_VALUE;
+        if (!opened) return false;
+
+        LARGE_INTEGER size{};
+        HANDLE mapping = nullptr;
+        const char* view = nullptr;
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0 &&
+            static_cast<unsigned long long>(size.QuadPart) <= SIZE_MAX)
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping)
+            view = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+
+        if (view) {
+            TileMapParser parser(map, error, static_cast<std::size_t>(size.QuadPart));
+            if (parser.feed(view, static_cast<std::size_t>(size.QuadPart)))
+                parser.finish();
+            UnmapViewOfFile(view);
+        }
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+
+        // a failed parse is final, only a failed mapping falls back to streaming
+        return view != nullptr;
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        opened = fd >= 0;
+        if (!opened) return false;
+
+        struct stat info {};
+        void* view = MAP_FAILED;
+        std::size_t size = 0;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            size = static_cast<std::size_t>(info.st_size);
+            view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        close(fd);
+        if (view == MAP_FAILED) return false;
+
+        madvise(view, size, MADV_SEQUENTIAL);
+        TileMapParser parser(map, error, size);
+        if (parser.feed(static_cast<const char*>(view), size))
+            parser.finish();
+        munmap(view, size);
+        return true;
+#endif
+    }
+#endif
+
+    bool parseStreamed(const std::string& path, TileMap& map, std::string& error)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            error = "failed to open " + path;
+            return false;
+        }
+
+        file.seekg(0, std::ios::end);
+        std::streamoff size = file.tellg();
+        file.seekg(0, std::ios::beg);
+
+        TileMapParser parser(map, error, size > 0 ? static_cast<std::size_t>(size) : 0);
+
+        char chunk[64 * 1024];
+        while (file) {
+            file.read(chunk, sizeof(chunk));
+            std::streamsize got = file.gcount();
+            if (got <= 0) break;
+            if (!parser.feed(chunk, static_cast<std::size_t>(got)))
+                return false;
+        }
+        return parser.finish();
+    }
+}
+
+bool TileMap::loadFromFile(const std::string& path, std::string& error)
+{
+#ifdef TILEMAP_MMAP
+    bool opened = false;
+    if (parseMapped(path, *this, error, opened))
+        return !empty();
+    if (!opened) {
+        error = "failed to open " + path;
+        return false;
+    }
+#endif
+    return parseStreamed(path, *this, error);
+}
+
+bool TileMap::loadFromMemory(const char* data, std::size_t size, std::string& error)
+{
+    TileMapParser parser(*this, error, size);
+    return parser.feed(data, size) && parser.finish();
+}
+
+void TileMap::assign(int rows_, int cols_, const char* tiles_)
+{
+    rows = rows_;
+    cols = cols_;
+    tiles.assign(tiles_, tiles_ + static_cast<std::size_t>(rows) * cols);
+}
+
+void TileMap::clear()
+{
+    tiles.clear();
+    rows = 0;
+    cols = 0;
+}
+
+int TileMap::count(char c) const
+{
+    return static_cast<int>(std::count(tiles.begin(), tiles.end(), c));
+}
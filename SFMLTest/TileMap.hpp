@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Level map characters in one contiguous row-major buffer, tile (row, col) is at row * cols + col.
+/// Loading streams the file straight in to the buffer, memory mapped when the platform allows it,
+/// so no line is ever copied in to its own string. Every row has to be as wide as the first one.
+/// </summary>
+class TileMap {
+public:
+    // Reads a map file, on failure the map is left empty and error tells why
+    bool loadFromFile(const std::string& path, std::string& error);
+
+    // Same parser over text already in memory
+    bool loadFromMemory(const char* data, std::size_t size, std::string& error);
+
+    // Copies rows * cols tiles that are already known to be a valid map, used by the level cache
+    void assign(int rows, int cols, const char* tiles);
+
+    // Empties the map, the buffer keeps its capacity for the next load
+    void clear();
+
+    char at(int row, int col) const { return tiles[static_cast<std::size_t>(row) * cols + col]; }
+    const char* getRow(int row) const { return tiles.data() + static_cast<std::size_t>(row) * cols; }
+    const char* data() const { return tiles.data(); }
+
+    int getRows() const { return rows; }
+    int getCols() const { return cols; }
+    bool empty() const { return rows == 0; }
+
+    // Number of tiles holding c
+    int count(char c) const;
+
+private:
+    std::vector<char> tiles;
+    int rows = 0;
+    int cols = 0;
+
+    friend class TileMapParser;
+};
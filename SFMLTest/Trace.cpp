@@ -0,0 +1,210 @@
+// Trace.cpp
+#include "Trace.hpp"
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Trace {
+
+    namespace {
+        using Clock = std::chrono::steady_clock;
+
+        struct Event {
+            const char* name;
+            std::int64_t start;     // ns since the capture started
+            std::int64_t duration;  // ns, zones only
+            double value;           // counters only
+            char phase;             // 'X' zone, 'C' counter
+        };
+
+        // events are published by bumping count, so the writer can keep going while stop reads
+        struct Chunk {
+            static constexpr int Capacity = 4096;
+            Event events[Capacity];
+            std::atomic<int> count{ 0 };
+            std::atomic<Chunk*> next{ nullptr };
+        };
+
+        struct ThreadBuffer {
+            Chunk* head = nullptr;
+            Chunk* tail = nullptr;  // only touched by the owning thread
+            int id = 0;
+            std::string name;
+            bool retired = false;   // its thread ended, a new thread of the same name carries on in it
+
+            ~ThreadBuffer() {
+                Chunk* chunk = head;
+                while (chunk) {
+                    Chunk* next = chunk->next.load(std::memory_order_relaxed);
+                    delete chunk;
+                    chunk = next;
+                }
+            }
+        };
+
+        std::atomic<bool> enabled{ false };
+        Clock::time_point epoch;
+        std::string outputPath;
+
+        // buffers live until exit, threads that end still leave their events behind
+        std::mutex registryMutex;
+        std::vector<std::unique_ptr<ThreadBuffer>> registry;
+
+        // the buffer is only made when the thread records its first event, a thread that just
+        // gets a name costs nothing while tracing is off
+        struct LocalThread {
+            ThreadBuffer* buffer = nullptr;
+            std::string name;
+
+            ~LocalThread() {
+                if (!buffer) return;
+                std::lock_guard<std::mutex> lock(registryMutex);
+                buffer->retired = true;
+            }
+        };
+        thread_local LocalThread local;
+
+        ThreadBuffer& threadBuffer() {
+            if (!local.buffer) {
+                std::lock_guard<std::mutex> lock(registryMutex);
+
+                // a restarted thread picks up the row of its previous run instead of adding one
+                if (!local.name.empty()) {
+                    for (const auto& buffer : registry) {
+                        if (buffer->retired && buffer->name == local.name) {
+                            buffer->retired = false;
+                            local.buffer = buffer.get();
+                            return *local.buffer;
+                        }
+                    }
+                }
+
+                auto buffer = std::make_unique<ThreadBuffer>();
+                buffer->head = buffer->tail = new Chunk();
+                buffer->id = static_cast<int>(registry.size());
+                if (!local.name.empty())
+                    buffer->name = local.name;
+                else
+                    buffer->name = buffer->id == 0 ? "main" : "thread " + std::to_string(buffer->id);
+                local.buffer = buffer.get();
+                registry.push_back(std::move(buffer));
+            }
+            return *local.buffer;
+        }
+
+        void append(const Event& event) {
+            ThreadBuffer& buffer = threadBuffer();
+            Chunk* chunk = buffer.tail;
+
+            int index = chunk->count.load(std::memory_order_relaxed);
+            if (index == Chunk::Capacity) {
+                Chunk* fresh = new Chunk();
+                chunk->next.store(fresh, std::memory_order_release);
+                buffer.tail = chunk = fresh;
+                index = 0;
+            }
+
+            chunk->events[index] = event;
+            chunk->count.store(index + 1, std::memory_order_release);
+        }
+
+        std::int64_t nanoseconds(Clock::time_point time) {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(time - epoch).count();
+        }
+
+        void writeEscaped(std::ostream& out, const std::string& text) {
+            for (char c : text) {
+                if (c == '"' || c == '\\') out << '\\';
+                out << c;
+            }
+        }
+    }
+
+    void start(const std::string& path) {
+        outputPath = path;
+        epoch = Clock::now();
+        threadBuffer();  // the starting thread is listed first
+        enabled.store(true, std::memory_order_release);
+    }
+
+    bool isEnabled() {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    void setThreadName(const char* name) {
+        local.name = name;
+        if (local.buffer) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            local.buffer->name = name;
+        }
+    }
+
+    void counter(const char* name, double value) {
+        if (!isEnabled()) return;
+        append({ name, nanoseconds(Clock::now()), 0, value, 'C' });
+    }
+
+    // timestamps are written in microseconds as the format expects
+    void stop() {
+        if (!enabled.exchange(false)) return;
+
+        std::ofstream file(outputPath);
+        if (!file) {
+            std::cerr << "Failed to write trace: " << outputPath << "\n";
+            return;
+        }
+
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        bool first = true;
+        auto separator = [&]() {
+            if (!first) file << ",\n";
+            first = false;
+        };
+
+        // whole microseconds with nanosecond decimals, the default precision rounds late timestamps
+        file << std::fixed << std::setprecision(3);
+
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const auto& buffer : registry) {
+            separator();
+            file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+                << ",\"args\":{\"name\":\"";
+            writeEscaped(file, buffer->name);
+            file << "\"}}";
+
+            for (Chunk* chunk = buffer->head; chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+                int count = chunk->count.load(std::memory_order_acquire);
+                for (int i = 0; i < count; ++i) {
+                    const Event& event = chunk->events[i];
+                    separator();
+                    file << "{\"name\":\"" << event.name << "\",\"ph\":\"" << event.phase
+                        << "\",\"pid\":1,\"tid\":" << buffer->id << ",\"ts\":" << event.start / 1000.0;
+                    if (event.phase == 'X')
+                        file << ",\"dur\":" << event.duration / 1000.0;
+                    else
+                        file << ",\"args\":{\"value\":" << event.value << "}";
+                    file << "}";
+                }
+            }
+        }
+        file << "\n]}\n";
+
+        std::cout << "Trace written to " << outputPath << "\n";
+    }
+
+    Zone::Zone(const char* name_) : name(name_), active(isEnabled()) {
+        if (active) begin = Clock::now();
+    }
+
+    Zone::~Zone() {
+        if (!active || !isEnabled()) return;
+
+        Clock::time_point end = Clock::now();
+        append({ name, nanoseconds(begin), nanoseconds(end) - nanoseconds(begin), 0.0, 'X' });
+    }
+}
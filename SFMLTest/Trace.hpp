@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+/// <summary>
+/// Timeline tracing written as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+/// Every thread appends its events to its own buffer without locking. While tracing is off a
+/// zone costs one relaxed atomic load. Names must be string literals, only the pointer is kept.
+/// </summary>
+namespace Trace {
+
+    // One capture per run: start begins recording, stop writes the file
+    void start(const std::string& path);
+    void stop();
+    bool isEnabled();
+
+    // Name shown for the calling thread in the viewer
+    void setThreadName(const char* name);
+
+    // A value plotted over time
+    void counter(const char* name, double value);
+
+    // Records the time between construction and destruction as one slice
+    class Zone {
+    public:
+        explicit Zone(const char* name);
+        ~Zone();
+
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+
+    private:
+        const char* name;
+        std::chrono::steady_clock::time_point begin;
+        bool active;
+    };
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+// Times the rest of the enclosing scope
+#define TRACE_ZONE(name) Trace::Zone TRACE_CONCAT(traceZone, __LINE__)(name)
+
+#define TRACE_COUNTER(name, value) \
+    do { if (Trace::isEnabled()) Trace::counter(name, static_cast<double>(value)); } while (false)